@@ -0,0 +1,101 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "counters.h"
+
+namespace bench {
+
+typedef void (*BenchFunc)();
+
+int Register(const char* name, BenchFunc func);
+
+// Settings from the bench_calc command line.
+struct Options {
+    size_t repetitions = 10;    // timed samples per measurement
+    double minSeconds = 0.5;    // default total time of the samples
+    double warmupSeconds = 0.1; // untimed calls before the first sample
+};
+
+Options& GetOptions();
+
+// Records one measurement: `seconds[i]` is the time of sample i, each of
+// callsPerSample calls processing itemsPerCall items. Prints the median
+// throughput with its 10th-90th percentile range, keeps the samples for the
+// JSON report and returns the median in items per second. `counts`, when
+// given, holds the hardware counters over all samples (see StopCounters)
+// and is reported per item and per token.
+double Record(const std::string& label, double itemsPerCall, size_t callsPerSample, const std::vector<double>& seconds,
+    const double* counts = nullptr);
+
+// Tokens of input per item for the next measurement, so that counters are
+// also reported per token. Reset by every Record().
+void SetTokensPerItem(double tokens);
+
+// Keeps the compiler from discarding the computation of a benchmarked value.
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+// Warms up by calling body() for warmupSeconds, which also estimates the time
+// of a call, then takes `repetitions` samples of equally many calls that
+// together last about minSeconds (the --min-time default when 0), with every
+// call accounting for itemsPerCall items. Returns the median throughput.
+template<typename F>
+double Measure(const std::string& label, double itemsPerCall, F body, double minSeconds = 0) {
+    typedef std::chrono::steady_clock clock;
+    const Options& options = GetOptions();
+    if (minSeconds <= 0) {
+        minSeconds = options.minSeconds;
+    }
+
+    size_t calls = 0;
+    double elapsed = 0;
+    clock::time_point start = clock::now();
+    do {
+        body();
+        calls++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < options.warmupSeconds);
+
+    size_t repetitions = std::max<size_t>(options.repetitions, 1);
+    double perCall = elapsed / calls;
+    size_t callsPerSample = std::max<size_t>(1, static_cast<size_t>(minSeconds / repetitions / perCall));
+
+    std::vector<double> seconds(repetitions);
+    bool counting = CountersOpen();
+    if (counting) {
+        StartCounters();
+    }
+    for (size_t r = 0; r < repetitions; r++) {
+        start = clock::now();
+        for (size_t c = 0; c < callsPerSample; c++) {
+            body();
+        }
+        seconds[r] = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    double counts[COUNTER_KINDS];
+    if (counting) {
+        StopCounters(counts);
+    }
+    return Record(label, itemsPerCall, callsPerSample, seconds, counting ? counts : nullptr);
+}
+
+}
+
+#define BENCHMARK(name) \
+    static void name(); \
+    static int name##_registered = bench::Register(#name, name); \
+    static void name()
+
+#endif
@@ -0,0 +1,72 @@
+#include "bench.h"
+#include "TArithmeticExpression.h"
+#include "TThreadPool.h"
+#include <algorithm>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t kRequests = 2000;
+const size_t kExpressionsPerRequest = 16;
+const size_t kEvaluationsPerExpression = 16;
+
+std::vector<std::string> Formulas() {
+    std::vector<std::string> formulas;
+    for (size_t i = 0; i < kExpressionsPerRequest; i++) {
+        std::string n = std::to_string(i + 1);
+        formulas.push_back("(a+" + n + ".5)*(b-c/" + n + ")+sin(a*b)*cos(c+" + n + ")-(a+b+c)/(" + n + "+b*b)");
+    }
+    return formulas;
+}
+
+// A request compiles a set of expressions, evaluates each a few times and
+// drops everything. With an arena, all of it lives in a per-thread buffer
+// that is released in one shot at the end of the request.
+double RunRequest(const std::vector<std::string>& formulas, std::pmr::memory_resource* arena) {
+    double sum = 0;
+    double values[] = { 0.5, 1.5, 2.5 };
+    for (const std::string& formula : formulas) {
+        TArithmeticExpression expr(formula, arena);
+        for (size_t i = 0; i < kEvaluationsPerExpression; i++) {
+            values[0] = i * 0.25;
+            sum += expr.Calculate(values);
+        }
+    }
+    return sum;
+}
+
+void MeasureRequests(const char* kind, size_t threads, bool useArena) {
+    std::vector<std::string> formulas = Formulas();
+    TThreadPool pool(threads);
+
+    bench::Measure(std::string("requests, ") + kind + ", " + std::to_string(threads) + " threads", kRequests, [&] {
+        pool.ParallelFor(0, kRequests, 16, [&](size_t begin, size_t end) {
+            thread_local std::vector<char> buffer(1 << 20);
+            for (size_t r = begin; r < end; r++) {
+                if (useArena) {
+                    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+                    bench::DoNotOptimize(RunRequest(formulas, &arena));
+                }
+                else {
+                    bench::DoNotOptimize(RunRequest(formulas, nullptr));
+                }
+            }
+        });
+    });
+}
+
+}
+
+BENCHMARK(ArenaVersusHeap) {
+    size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 1;; threads = std::min(threads * 2, hw)) {
+        MeasureRequests("global heap", threads, false);
+        MeasureRequests("monotonic arena", threads, true);
+        if (threads == hw) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#include "bench.h"
+#include "TArithmeticExpression.h"
+#include <map>
+#include <vector>
+
+namespace {
+
+const char* kFormula = "(a+b)*c-sin(a)/2+b*b";
+const size_t kRows = 100000;
+
+struct Columns {
+    std::vector<std::vector<double>> data;
+    std::vector<const double*> ptrs;
+
+    explicit Columns(size_t vars) : data(vars, std::vector<double>(kRows)), ptrs(vars) {
+        for (size_t v = 0; v < vars; v++) {
+            for (size_t r = 0; r < kRows; r++) {
+                data[v][r] = 0.001 * r + v + 1;
+            }
+            ptrs[v] = data[v].data();
+        }
+    }
+};
+
+}
+
+BENCHMARK(BatchVersusRowByRow) {
+    TArithmeticExpression expr(kFormula);
+    std::vector<std::string> names = expr.GetOperands();
+    Columns cols(names.size());
+    std::vector<double> out(kRows);
+
+    bench::Measure("rows, Calculate(map) per row", kRows, [&] {
+        std::map<std::string, double> values;
+        for (size_t r = 0; r < kRows; r++) {
+            for (size_t v = 0; v < names.size(); v++) {
+                values[names[v]] = cols.data[v][r];
+            }
+            out[r] = expr.Calculate(values);
+        }
+        bench::DoNotOptimize(out[kRows - 1]);
+    });
+
+    bench::Measure("rows, Calculate(slots) per row", kRows, [&] {
+        std::vector<double> row(names.size());
+        for (size_t r = 0; r < kRows; r++) {
+            for (size_t v = 0; v < names.size(); v++) {
+                row[v] = cols.data[v][r];
+            }
+            out[r] = expr.Calculate(row.data());
+        }
+        bench::DoNotOptimize(out[kRows - 1]);
+    });
+
+    bench::Measure("rows, CalculateBatch", kRows, [&] {
+        expr.CalculateBatch(cols.ptrs.data(), out.data(), kRows);
+        bench::DoNotOptimize(out[kRows - 1]);
+    });
+}
@@ -0,0 +1,54 @@
+#include "bench.h"
+#include "TArithmeticExpression.h"
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// Each formula repeats subexpressions; its twin spells the repeats with
+// distinct variables bound to the same values, so nothing can be shared.
+struct CorpusEntry {
+    const char* shared;
+    const char* unshared;
+};
+
+const CorpusEntry kCorpus[] = {
+    { "(x+1)*(x+1)*(x+1)+(x+1)*(x+1)+(x+1)",
+      "(a+1)*(b+1)*(c+1)+(d+1)*(e+1)+(f+1)" },
+    { "(x*x+y*y)*(x*x+y*y)-2*(x*x+y*y)+1",
+      "(a*a+b*b)*(c*c+d*d)-2*(e*e+f*f)+1" },
+    { "sin(x+y)*cos(x+y)+sin(x+y)*sin(x+y)",
+      "sin(a+b)*cos(c+d)+sin(e+f)*sin(g+h)" },
+    { "(x-y)*(x-y)*(x-y)*(x-y)/((x-y)*(x-y)+1)",
+      "(a-b)*(c-d)*(e-f)*(g-h)/((i-j)*(k-l)+1)" },
+};
+
+}
+
+BENCHMARK(CommonSubexpressionElimination) {
+    const size_t calls = 100000;
+    for (const CorpusEntry& entry : kCorpus) {
+        TArithmeticExpression shared(entry.shared);
+        TArithmeticExpression unshared(entry.unshared);
+        std::vector<double> sharedValues(shared.GetOperands().size(), 0.75);
+        std::vector<double> unsharedValues(unshared.GetOperands().size(), 0.75);
+
+        std::printf("  %s: %zu nodes deduplicated, %zu -> %zu instructions\n", entry.shared,
+            shared.GetDeduplicatedNodes(), unshared.GetProgram().size(), shared.GetProgram().size());
+
+        bench::Measure("evaluations, without sharing", calls, [&] {
+            double sum = 0;
+            for (size_t i = 0; i < calls; i++) {
+                sum += unshared.Calculate(unsharedValues.data());
+            }
+            bench::DoNotOptimize(sum);
+        }, 0.2);
+        bench::Measure("evaluations, with sharing", calls, [&] {
+            double sum = 0;
+            for (size_t i = 0; i < calls; i++) {
+                sum += shared.Calculate(sharedValues.data());
+            }
+            bench::DoNotOptimize(sum);
+        }, 0.2);
+    }
+}
@@ -0,0 +1,140 @@
+#include "bench.h"
+#include "TArithmeticExpression.h"
+#include "TExpressionGenerator.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t kSizes[] = { 8, 64, 512 };
+const size_t kDepths[] = { 16, 128, 1024 };
+
+// Formula families by number of terms. Variables cycle through a..h.
+std::string Variable(size_t i) {
+    return std::string(1, static_cast<char>('a' + i % 8));
+}
+
+std::string Polynomial(size_t terms) {
+    static const char* const ops[] = { "+", "-", "*", "/" };
+    std::string s = "a";
+    for (size_t i = 1; i < terms; i++) {
+        s += ops[i % 4] + std::string("(") + Variable(i) + "+" + std::to_string(i) + ".5)";
+    }
+    return s;
+}
+
+std::string Constants(size_t terms) {
+    static const char* const ops[] = { "+", "-", "*", "/" };
+    std::string s = "1";
+    for (size_t i = 1; i < terms; i++) {
+        s += ops[i % 4] + std::string("(") + std::to_string(i) + "+0.5)";
+    }
+    return s;
+}
+
+std::string Trigonometric(size_t terms) {
+    std::string s = "sin(a)";
+    for (size_t i = 1; i < terms; i++) {
+        s += i % 2 ? "+cos(" : "*sin(";
+        s += Variable(i) + "*" + std::to_string(i) + ")";
+    }
+    return s;
+}
+
+std::string Nested(size_t depth) {
+    std::string s = "a";
+    for (size_t i = 0; i < depth; i++) {
+        s = (i % 2 ? "b*(" : "a-(") + s + ")";
+    }
+    return s;
+}
+
+struct Family {
+    const char* name;
+    std::string (*make)(size_t);
+};
+
+const Family kFamilies[] = {
+    { "polynomial", Polynomial },
+    { "constants", Constants },
+    { "trigonometric", Trigonometric },
+};
+
+// Tokens of the postfix form, for per-token counter rates.
+double Tokens(const std::string& formula) {
+    std::string postfix = TArithmeticExpression(formula).GetPostfix();
+    return 1.0 + std::count(postfix.begin(), postfix.end(), ' ');
+}
+
+void MeasureConstruction(const std::string& label, const std::string& formula) {
+    const size_t calls = 16;
+    bench::SetTokensPerItem(Tokens(formula));
+    bench::Measure("constructions, " + label, calls, [&] {
+        for (size_t i = 0; i < calls; i++) {
+            TArithmeticExpression expr(formula);
+            bench::DoNotOptimize(expr.GetStackDepth());
+        }
+    });
+}
+
+void MeasureEvaluation(const std::string& label, const std::string& formula) {
+    const size_t calls = 1000;
+    TArithmeticExpression expr(formula);
+    std::vector<double> values(expr.GetOperands().size(), 0.75);
+    bench::SetTokensPerItem(Tokens(formula));
+    bench::Measure("evaluations, " + label, calls, [&] {
+        double sum = 0;
+        for (size_t i = 0; i < calls; i++) {
+            sum += expr.Calculate(values.data());
+        }
+        bench::DoNotOptimize(sum);
+    });
+}
+
+}
+
+// Parse, postfix conversion, optimization and compilation of one expression.
+BENCHMARK(Construction) {
+    for (const Family& family : kFamilies) {
+        for (size_t terms : kSizes) {
+            MeasureConstruction(std::string(family.name) + ", " + std::to_string(terms) + " terms",
+                family.make(terms));
+        }
+    }
+}
+
+// Evaluation of a compiled expression by slots; "constants" has no variables
+// and folds to a single literal.
+BENCHMARK(Evaluation) {
+    for (const Family& family : kFamilies) {
+        for (size_t terms : kSizes) {
+            MeasureEvaluation(std::string(family.name) + ", " + std::to_string(terms) + " terms",
+                family.make(terms));
+        }
+    }
+}
+
+// Parenthesised right-nested chains, where the operator stack and the
+// evaluation stack both grow with the depth.
+BENCHMARK(DeepNesting) {
+    for (size_t depth : kDepths) {
+        std::string formula = Nested(depth);
+        MeasureConstruction("depth " + std::to_string(depth), formula);
+        MeasureEvaluation("depth " + std::to_string(depth), formula);
+    }
+}
+
+// Seeded random expressions from TExpressionGenerator at growing sizes, so
+// the scaling of construction and evaluation is comparable between machines.
+BENCHMARK(GeneratedScaling) {
+    for (size_t tokens : { 1000, 10000, 100000 }) {
+        TExpressionGenerator::Options options;
+        options.seed = 2024;
+        options.tokens = tokens;
+        options.maxDepth = 32;
+        std::string formula = TExpressionGenerator(options).Next();
+        MeasureConstruction(std::to_string(tokens) + " generated tokens", formula);
+        MeasureEvaluation(std::to_string(tokens) + " generated tokens", formula);
+    }
+}
@@ -0,0 +1,55 @@
+#include "bench.h"
+#include "TJitExpression.h"
+#include <map>
+#include <vector>
+
+namespace {
+
+void CompareJit(const char* formula) {
+    TArithmeticExpression expr(formula);
+    TJitExpression jit(expr, true);
+    std::vector<std::string> names = expr.GetOperands();
+    std::vector<double> values(names.size(), 0.5);
+    std::map<std::string, double> named;
+    for (const std::string& n : names) {
+        named[n] = 0.5;
+    }
+    const size_t calls = 100000;
+
+    bench::Measure("evaluations, Calculate(map)", calls, [&] {
+        double sum = 0;
+        for (size_t i = 0; i < calls; i++) {
+            named[names[0]] = i * 1e-6;
+            sum += expr.Calculate(named);
+        }
+        bench::DoNotOptimize(sum);
+    });
+
+    bench::Measure("evaluations, Calculate(slots)", calls, [&] {
+        double sum = 0;
+        for (size_t i = 0; i < calls; i++) {
+            values[0] = i * 1e-6;
+            sum += expr.Calculate(values.data());
+        }
+        bench::DoNotOptimize(sum);
+    });
+
+    bench::Measure(jit.IsCompiled() ? "evaluations, JIT" : "evaluations, JIT (interpreter fallback)", calls, [&] {
+        double sum = 0;
+        for (size_t i = 0; i < calls; i++) {
+            values[0] = i * 1e-6;
+            sum += jit.Calculate(values.data());
+        }
+        bench::DoNotOptimize(sum);
+    });
+}
+
+}
+
+BENCHMARK(JitArithmetic) {
+    CompareJit("(a+b)*(c-d)/(e+1)+a*b*c-d/(e+2)");
+}
+
+BENCHMARK(JitTrigonometric) {
+    CompareJit("sin(a)*cos(b)+sin(a+b)-cos(a*b)");
+}
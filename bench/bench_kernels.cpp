@@ -0,0 +1,38 @@
+#include "bench.h"
+#include "TBatchKernels.h"
+#include <string>
+#include <vector>
+
+BENCHMARK(BatchKernelsPerIsa) {
+    const size_t n = 4096;
+    std::vector<double> a(n), b(n), out(n);
+    for (size_t i = 0; i < n; i++) {
+        a[i] = 0.37 * i - 700.0;
+        b[i] = 1.0 + 0.001 * i;
+    }
+
+    const TBatchKernels::Isa all[] = { TBatchKernels::SCALAR, TBatchKernels::SSE2, TBatchKernels::AVX2, TBatchKernels::AVX512 };
+    for (TBatchKernels::Isa isa : all) {
+        const TBatchKernels* k = TBatchKernels::Get(isa);
+        if (!k) {
+            continue;
+        }
+        std::string prefix = std::string("elements, ") + k->name + " ";
+        bench::Measure(prefix + "mul", n, [&] {
+            k->mul(out.data(), a.data(), b.data(), n);
+            bench::DoNotOptimize(out[n - 1]);
+        }, 0.2);
+        bench::Measure(prefix + "div", n, [&] {
+            k->div(out.data(), a.data(), b.data(), n);
+            bench::DoNotOptimize(out[n - 1]);
+        }, 0.2);
+        bench::Measure(prefix + "sin", n, [&] {
+            k->sin(out.data(), a.data(), n);
+            bench::DoNotOptimize(out[n - 1]);
+        }, 0.2);
+        bench::Measure(prefix + "cos", n, [&] {
+            k->cos(out.data(), a.data(), n);
+            bench::DoNotOptimize(out[n - 1]);
+        }, 0.2);
+    }
+}
@@ -0,0 +1,64 @@
+#include "bench.h"
+#include "TArithmeticExpression.h"
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Every call's input depends on the previous result, so calls cannot overlap
+// and the rate is the inverse of the single-call latency.
+void MeasureLatency(const std::string& formula) {
+    TArithmeticExpression expr(formula);
+    std::vector<std::string> names = expr.GetOperands();
+    std::vector<double> values(names.size(), 0.5);
+    std::map<std::string, double> named;
+    for (const std::string& n : names) {
+        named[n] = 0.5;
+    }
+    TEvaluationContext ctx(*expr.GetCompiledProgram());
+    const size_t calls = 100000;
+
+    std::printf("  %s (stack depth %zu)\n", formula.size() > 40 ? "deep expression" : formula.c_str(), expr.GetStackDepth());
+
+    bench::Measure("evaluations, Calculate(map)", calls, [&] {
+        double last = 0;
+        for (size_t i = 0; i < calls; i++) {
+            named[names[0]] = last * 1e-9;
+            last = expr.Calculate(named);
+        }
+        bench::DoNotOptimize(last);
+    });
+
+    bench::Measure("evaluations, Calculate(slots)", calls, [&] {
+        double last = 0;
+        for (size_t i = 0; i < calls; i++) {
+            values[0] = last * 1e-9;
+            last = expr.Calculate(values.data());
+        }
+        bench::DoNotOptimize(last);
+    });
+
+    bench::Measure("evaluations, Calculate(context)", calls, [&] {
+        double last = 0;
+        for (size_t i = 0; i < calls; i++) {
+            ctx.SetValue(0, last * 1e-9);
+            last = expr.Calculate(ctx);
+        }
+        bench::DoNotOptimize(last);
+    });
+}
+
+}
+
+BENCHMARK(CalculateLatency) {
+    MeasureLatency("a + b*2");
+    MeasureLatency("(a+b)*(c-d)/(e+1)+sin(a)*cos(b)");
+
+    std::string deep = "a";
+    for (int i = 0; i < 100; i++) {
+        deep = "a - (b + " + deep + ")";
+    }
+    MeasureLatency(deep);
+}
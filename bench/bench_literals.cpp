@@ -0,0 +1,37 @@
+#include "bench.h"
+#include "TArithmeticExpression.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t kLiterals = 256;
+
+// Sums of literals in the shapes real input takes: integers, short and long
+// fractions, and exponent notation. Parsing dominates construction here.
+std::vector<std::string> LiteralSums() {
+    std::string integers, fractions, precise, exponents;
+    for (size_t i = 0; i < kLiterals; i++) {
+        std::string n = std::to_string(i + 1);
+        const char* plus = i ? "+" : "";
+        integers += plus + n;
+        fractions += plus + n + ".25";
+        precise += plus + n + ".141592653589793";
+        exponents += plus + n + ".5e-" + std::to_string(i % 300);
+    }
+    return { integers, fractions, precise, exponents };
+}
+
+}
+
+BENCHMARK(ParseLiterals) {
+    const char* kinds[] = { "integers", "short fractions", "17-digit fractions", "exponents" };
+    std::vector<std::string> sums = LiteralSums();
+    for (size_t k = 0; k < sums.size(); k++) {
+        const std::string& infix = sums[k];
+        bench::Measure(std::string("literals, ") + kinds[k], kLiterals, [&] {
+            TArithmeticExpression expr(infix);
+            bench::DoNotOptimize(expr.Calculate());
+        });
+    }
+}
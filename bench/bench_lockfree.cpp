@@ -0,0 +1,67 @@
+#include "bench.h"
+#include "TDynamicStack.h"
+#include "TLockFreeStack.h"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t kOpsPerThread = 200000;
+
+// Mutex-guarded TDynamicStack with the same hand-off interface.
+class TLockedStack {
+    std::mutex lock;
+    TDynamicStack<long long, 64> stack;
+
+public:
+    void Push(long long value) {
+        std::lock_guard<std::mutex> guard(lock);
+        stack.Push(value);
+    }
+
+    bool TryPop(long long& out) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (stack.IsEmpty()) {
+            return false;
+        }
+        out = stack.PopUnchecked();
+        return true;
+    }
+};
+
+// Every thread pushes and pops in turn, so all of them contend for the top.
+template<typename Stack>
+void MeasureContention(const char* kind, size_t threads) {
+    Stack stack;
+    bench::Measure(std::string("push+pop pairs, ") + kind + ", " + std::to_string(threads) + " threads",
+        static_cast<double>(kOpsPerThread) * threads, [&] {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.emplace_back([&stack, t] {
+                long long sum = 0;
+                long long value;
+                for (size_t i = 0; i < kOpsPerThread; i++) {
+                    stack.Push(static_cast<long long>(t * kOpsPerThread + i));
+                    if (stack.TryPop(value)) {
+                        sum += value;
+                    }
+                }
+                bench::DoNotOptimize(sum);
+            });
+        }
+        for (std::thread& w : workers) {
+            w.join();
+        }
+    });
+}
+
+}
+
+BENCHMARK(ConcurrentStackContention) {
+    for (size_t threads : { 1, 2, 4, 8 }) {
+        MeasureContention<TLockFreeStack<long long>>("TLockFreeStack", threads);
+        MeasureContention<TLockedStack>("mutex + TDynamicStack", threads);
+    }
+}
@@ -0,0 +1,279 @@
+#include "bench.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Case {
+    const char* name;
+    bench::BenchFunc func;
+};
+
+struct Result {
+    std::string benchmark;
+    std::string label;
+    double itemsPerCall;
+    size_t callsPerSample;
+    std::vector<double> rates;  // items/s of every sample, in sampling order
+    double median;
+    double mean;
+    double p10;
+    double p90;
+    double min;
+    double max;
+    double tokensPerItem;
+    bool counted;
+    double perItem[bench::COUNTER_KINDS];   // negative when unavailable
+};
+
+std::vector<Case>& Cases() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+std::vector<Result>& Results() {
+    static std::vector<Result> results;
+    return results;
+}
+
+const char* currentBenchmark = "";
+double tokensPerItem = 0;
+
+// Linear interpolation between the closest ranks of sorted values.
+double Percentile(const std::vector<double>& sorted, double p) {
+    double rank = p * (sorted.size() - 1);
+    size_t below = static_cast<size_t>(rank);
+    size_t above = std::min(below + 1, sorted.size() - 1);
+    return sorted[below] + (sorted[above] - sorted[below]) * (rank - below);
+}
+
+void WriteString(std::FILE* out, const std::string& text) {
+    std::fputc('"', out);
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            std::fprintf(out, "\\%c", c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            std::fprintf(out, "\\u%04x", c);
+        }
+        else {
+            std::fputc(c, out);
+        }
+    }
+    std::fputc('"', out);
+}
+
+bool WriteJson(const char* path) {
+    std::FILE* out = std::fopen(path, "w");
+    if (!out) {
+        return false;
+    }
+    const bench::Options& options = bench::GetOptions();
+    std::fprintf(out, "{\n  \"context\": {\n");
+#if defined(__VERSION__)
+    std::fprintf(out, "    \"compiler\": ");
+    WriteString(out, __VERSION__);
+    std::fprintf(out, ",\n");
+#endif
+#if defined(NDEBUG)
+    std::fprintf(out, "    \"assertions\": false,\n");
+#else
+    std::fprintf(out, "    \"assertions\": true,\n");
+#endif
+    std::fprintf(out, "    \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    std::fprintf(out, "    \"repetitions\": %zu,\n", options.repetitions);
+    std::fprintf(out, "    \"min_time\": %g,\n", options.minSeconds);
+    std::fprintf(out, "    \"warmup\": %g,\n", options.warmupSeconds);
+    std::fprintf(out, "    \"counters\": %s\n  },\n", bench::CountersOpen() ? "true" : "false");
+
+    std::fprintf(out, "  \"results\": [");
+    for (size_t i = 0; i < Results().size(); i++) {
+        const Result& r = Results()[i];
+        std::fprintf(out, "%s\n    {\n      \"benchmark\": ", i ? "," : "");
+        WriteString(out, r.benchmark);
+        std::fprintf(out, ",\n      \"label\": ");
+        WriteString(out, r.label);
+        std::fprintf(out, ",\n      \"unit\": \"items/s\",\n");
+        std::fprintf(out, "      \"items_per_call\": %.17g,\n", r.itemsPerCall);
+        std::fprintf(out, "      \"calls_per_sample\": %zu,\n", r.callsPerSample);
+        std::fprintf(out, "      \"median\": %.17g,\n", r.median);
+        std::fprintf(out, "      \"mean\": %.17g,\n", r.mean);
+        std::fprintf(out, "      \"p10\": %.17g,\n", r.p10);
+        std::fprintf(out, "      \"p90\": %.17g,\n", r.p90);
+        std::fprintf(out, "      \"min\": %.17g,\n", r.min);
+        std::fprintf(out, "      \"max\": %.17g,\n", r.max);
+        if (r.counted) {
+            std::fprintf(out, "      \"tokens_per_item\": %.17g,\n", r.tokensPerItem);
+            std::fprintf(out, "      \"counters_per_item\": {");
+            bool first = true;
+            for (int k = 0; k < bench::COUNTER_KINDS; k++) {
+                if (r.perItem[k] >= 0) {
+                    std::fprintf(out, "%s\"%s\": %.17g", first ? "" : ", ", bench::kCounterNames[k], r.perItem[k]);
+                    first = false;
+                }
+            }
+            std::fprintf(out, "},\n");
+        }
+        std::fprintf(out, "      \"samples\": [");
+        for (size_t s = 0; s < r.rates.size(); s++) {
+            std::fprintf(out, "%s%.17g", s ? ", " : "", r.rates[s]);
+        }
+        std::fprintf(out, "]\n    }");
+    }
+    std::fprintf(out, "\n  ]\n}\n");
+    return std::fclose(out) == 0;
+}
+
+int Usage() {
+    std::fprintf(stderr,
+        "usage: bench_calc [options] [substring...]\n"
+        "  Runs the benchmarks whose name contains any substring (all by default).\n"
+        "  --repetitions N  timed samples per measurement (default 10)\n"
+        "  --min-time S     default seconds spent sampling a measurement (default 0.5)\n"
+        "  --warmup S       seconds of untimed calls before sampling (default 0.1)\n"
+        "  --json FILE      also write all samples and statistics to FILE\n"
+        "  --counters       read hardware performance counters (Linux)\n"
+        "  --list           print the benchmark names and exit\n");
+    return 2;
+}
+
+}
+
+int bench::Register(const char* name, BenchFunc func) {
+    Cases().push_back({ name, func });
+    return 0;
+}
+
+bench::Options& bench::GetOptions() {
+    static Options options;
+    return options;
+}
+
+void bench::SetTokensPerItem(double tokens) {
+    tokensPerItem = tokens;
+}
+
+double bench::Record(const std::string& label, double itemsPerCall, size_t callsPerSample, const std::vector<double>& seconds,
+    const double* counts) {
+    Result r{};
+    r.benchmark = currentBenchmark;
+    r.label = label;
+    r.itemsPerCall = itemsPerCall;
+    r.callsPerSample = callsPerSample;
+    double sum = 0;
+    for (double s : seconds) {
+        r.rates.push_back(itemsPerCall * callsPerSample / s);
+        sum += r.rates.back();
+    }
+
+    std::vector<double> sorted = r.rates;
+    std::sort(sorted.begin(), sorted.end());
+    r.median = Percentile(sorted, 0.5);
+    r.mean = sum / sorted.size();
+    r.p10 = Percentile(sorted, 0.1);
+    r.p90 = Percentile(sorted, 0.9);
+    r.min = sorted.front();
+    r.max = sorted.back();
+
+    std::printf("  %-40s %14.0f items/s  [%.0f .. %.0f]\n", label.c_str(), r.median, r.p10, r.p90);
+
+    r.tokensPerItem = tokensPerItem;
+    tokensPerItem = 0;
+    r.counted = counts != nullptr;
+    std::fill(r.perItem, r.perItem + bench::COUNTER_KINDS, -1.0);
+    if (counts) {
+        double items = itemsPerCall * callsPerSample * seconds.size();
+        std::printf("  %40s", "per item:");
+        for (int k = 0; k < bench::COUNTER_KINDS; k++) {
+            r.perItem[k] = counts[k] >= 0 ? counts[k] / items : -1;
+            if (r.perItem[k] >= 0) {
+                std::printf("  %s %.4g", bench::kCounterNames[k], r.perItem[k]);
+            }
+        }
+        if (r.perItem[bench::CYCLES] > 0 && r.perItem[bench::INSTRUCTIONS] >= 0) {
+            std::printf("  IPC %.2f", r.perItem[bench::INSTRUCTIONS] / r.perItem[bench::CYCLES]);
+        }
+        std::printf("\n");
+        if (r.tokensPerItem > 0) {
+            std::printf("  %40s", "per token:");
+            for (int k = 0; k < bench::COUNTER_KINDS; k++) {
+                if (r.perItem[k] >= 0) {
+                    std::printf("  %s %.4g", bench::kCounterNames[k], r.perItem[k] / r.tokensPerItem);
+                }
+            }
+            std::printf("\n");
+        }
+    }
+    std::fflush(stdout);
+    Results().push_back(r);
+    return r.median;
+}
+
+int main(int argc, char** argv) {
+    bench::Options& options = bench::GetOptions();
+    std::vector<const char*> filters;
+    const char* jsonPath = nullptr;
+    bool list = false;
+    bool counters = false;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+            options.repetitions = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--min-time") == 0 && hasValue) {
+            options.minSeconds = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+            options.warmupSeconds = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--json") == 0 && hasValue) {
+            jsonPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--counters") == 0) {
+            counters = true;
+        }
+        else if (std::strcmp(argv[i], "--list") == 0) {
+            list = true;
+        }
+        else if (std::strncmp(argv[i], "--", 2) == 0) {
+            return Usage();
+        }
+        else {
+            filters.push_back(argv[i]);
+        }
+    }
+
+    std::string why;
+    if (counters && !list && !bench::OpenCounters(why)) {
+        std::fprintf(stderr, "hardware counters unavailable: %s; reporting wall-clock time only\n", why.c_str());
+    }
+
+    for (const Case& c : Cases()) {
+        bool selected = filters.empty();
+        for (const char* filter : filters) {
+            selected = selected || std::strstr(c.name, filter) != nullptr;
+        }
+        if (!selected) {
+            continue;
+        }
+        if (list) {
+            std::printf("%s\n", c.name);
+            continue;
+        }
+        std::printf("%s\n", c.name);
+        currentBenchmark = c.name;
+        c.func();
+    }
+
+    if (jsonPath && !list && !WriteJson(jsonPath)) {
+        std::fprintf(stderr, "cannot write %s\n", jsonPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "bench.h"
+#include "TArithmeticExpression.h"
+#include "TThreadPool.h"
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* kFormula = "(a+b)*c-sin(a)/2+b*cos(c)";
+
+std::vector<size_t> ThreadCounts() {
+    size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> counts;
+    for (size_t t = 1; t < hw; t *= 2) {
+        counts.push_back(t);
+    }
+    counts.push_back(hw);
+    return counts;
+}
+
+void RunScaling(const char* kind, size_t rowsPerThread, bool weak) {
+    TArithmeticExpression expr(kFormula);
+    size_t maxThreads = ThreadCounts().back();
+    size_t maxRows = weak ? rowsPerThread * maxThreads : rowsPerThread;
+
+    std::vector<std::vector<double>> data(3, std::vector<double>(maxRows));
+    for (size_t v = 0; v < 3; v++) {
+        for (size_t r = 0; r < maxRows; r++) {
+            data[v][r] = 0.001 * r + v + 1;
+        }
+    }
+    const double* columns[] = { data[0].data(), data[1].data(), data[2].data() };
+    std::vector<double> out(maxRows);
+
+    for (size_t threads : ThreadCounts()) {
+        TThreadPool pool(threads);
+        size_t rows = weak ? rowsPerThread * threads : rowsPerThread;
+        bench::Measure(std::string("rows, ") + kind + " " + std::to_string(threads) + " threads", rows, [&] {
+            expr.CalculateBatch(columns, out.data(), rows, pool);
+            bench::DoNotOptimize(out[rows - 1]);
+        });
+    }
+}
+
+}
+
+BENCHMARK(ParallelBatchStrongScaling) {
+    RunScaling("strong", 2000000, false);
+}
+
+BENCHMARK(ParallelBatchWeakScaling) {
+    RunScaling("weak", 500000, true);
+}
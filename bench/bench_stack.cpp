@@ -0,0 +1,118 @@
+#include "bench.h"
+#include "TDynamicStack.h"
+#include "TSegmentedStack.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stack>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t kStacks = 10000;
+
+// Evaluator-like use: a short-lived stack per call, filled to `depth` and drained.
+template<typename Push, typename Pop, typename Make>
+void MeasureShortLived(const std::string& label, size_t depth, Make make, Push push, Pop pop) {
+    bench::Measure(label + ", depth " + std::to_string(depth), kStacks * depth, [&] {
+        double sum = 0;
+        for (size_t s = 0; s < kStacks; s++) {
+            auto st = make();
+            for (size_t i = 0; i < depth; i++) {
+                push(st, static_cast<double>(i));
+            }
+            for (size_t i = 0; i < depth; i++) {
+                sum += pop(st);
+            }
+        }
+        bench::DoNotOptimize(sum);
+    });
+}
+
+void CompareShortLived(size_t depth) {
+    MeasureShortLived("pushes, TDynamicStack<double>", depth,
+        [] { return TDynamicStack<double>(); },
+        [](TDynamicStack<double>& st, double v) { st.Push(v); },
+        [](TDynamicStack<double>& st) { return st.Pop(); });
+    MeasureShortLived("pushes, TDynamicStack<double, 32>", depth,
+        [] { return TDynamicStack<double, 32>(); },
+        [](TDynamicStack<double, 32>& st, double v) { st.Push(v); },
+        [](TDynamicStack<double, 32>& st) { return st.PopUnchecked(); });
+    MeasureShortLived("pushes, std::vector<double>", depth,
+        [] { return std::vector<double>(); },
+        [](std::vector<double>& st, double v) { st.push_back(v); },
+        [](std::vector<double>& st) { double v = st.back(); st.pop_back(); return v; });
+    MeasureShortLived("pushes, std::stack<double>", depth,
+        [] { return std::stack<double>(); },
+        [](std::stack<double>& st, double v) { st.push(v); },
+        [](std::stack<double>& st) { double v = st.top(); st.pop(); return v; });
+}
+
+// Times every push of one deep stack separately and prints the distribution;
+// growth by copying shows up in the tail, not in the median.
+template<typename Stack>
+void MeasurePushLatency(const char* label, size_t pushes) {
+    typedef std::chrono::steady_clock clock;
+    std::vector<double> ns(pushes);
+    Stack st;
+    for (size_t i = 0; i < pushes; i++) {
+        clock::time_point start = clock::now();
+        st.Push(static_cast<double>(i));
+        ns[i] = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    }
+    bench::DoNotOptimize(st.Top());
+
+    std::sort(ns.begin(), ns.end());
+    std::printf("  %-40s p50 %6.0f ns  p99 %6.0f ns  p99.9 %8.0f ns  max %10.0f ns\n", label,
+        ns[pushes / 2], ns[pushes * 99 / 100], ns[pushes * 999 / 1000], ns.back());
+}
+
+}
+
+BENCHMARK(StackPushLatency) {
+    const size_t pushes = 1 << 22;
+    MeasurePushLatency<TDynamicStack<double>>("push latency, TDynamicStack<double>", pushes);
+    MeasurePushLatency<TSegmentedStack<double>>("push latency, TSegmentedStack<double>", pushes);
+    MeasurePushLatency<TSegmentedStack<double, 4096>>("push latency, TSegmentedStack<double, 4096>", pushes);
+}
+
+BENCHMARK(StackShortLived) {
+    CompareShortLived(4);
+    CompareShortLived(16);
+    CompareShortLived(256);
+}
+
+BENCHMARK(StackStrings) {
+    const size_t depth = 64;
+    const std::string value = "a string long enough to live on the heap";
+
+    bench::Measure("pushes, TDynamicStack<string> move", kStacks * depth / 10, [&] {
+        size_t total = 0;
+        for (size_t s = 0; s < kStacks / 10; s++) {
+            TDynamicStack<std::string> st;
+            for (size_t i = 0; i < depth; i++) {
+                st.Push(std::string(value));
+            }
+            while (!st.IsEmpty()) {
+                total += st.PopUnchecked().size();
+            }
+        }
+        bench::DoNotOptimize(total);
+    });
+
+    bench::Measure("pushes, std::vector<string> move", kStacks * depth / 10, [&] {
+        size_t total = 0;
+        for (size_t s = 0; s < kStacks / 10; s++) {
+            std::vector<std::string> st;
+            for (size_t i = 0; i < depth; i++) {
+                st.push_back(std::string(value));
+            }
+            while (!st.empty()) {
+                total += st.back().size();
+                st.pop_back();
+            }
+        }
+        bench::DoNotOptimize(total);
+    });
+}
@@ -0,0 +1,58 @@
+#include "bench.h"
+#include "TArithmeticExpression.h"
+#include "TProgramFile.h"
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t kExpressions = 20000;
+
+std::vector<std::string> Formulas() {
+    std::vector<std::string> formulas;
+    for (size_t i = 0; i < kExpressions; i++) {
+        std::string n = std::to_string(i % 997 + 1);
+        formulas.push_back("(a+" + n + ".5)*(b-c/" + n + ")+sin(a*b)*cos(c+" + n + ")-(a+b+c)/(" + n + "+b*b)");
+    }
+    return formulas;
+}
+
+}
+
+// What a worker does on restart: get every expression it serves ready to
+// evaluate, either by compiling the text or by mapping a program file.
+BENCHMARK(StartupFromProgramFile) {
+    std::vector<std::string> formulas = Formulas();
+    std::string path = (std::filesystem::temp_directory_path() / "calc_bench_programs.bin").string();
+    {
+        std::vector<std::shared_ptr<const TCompiledProgram>> programs;
+        for (const std::string& formula : formulas) {
+            programs.push_back(TArithmeticExpression(formula).GetCompiledProgram());
+        }
+        TProgramFile::Write(path, programs, formulas);
+    }
+
+    bench::Measure("expressions, from text", kExpressions, [&] {
+        std::vector<std::shared_ptr<const TCompiledProgram>> loaded;
+        loaded.reserve(kExpressions);
+        for (const std::string& formula : formulas) {
+            loaded.push_back(TArithmeticExpression(formula).GetCompiledProgram());
+        }
+        bench::DoNotOptimize(loaded.back().get());
+    });
+
+    bench::Measure("expressions, from program file", kExpressions, [&] {
+        TProgramFile file(path);
+        std::vector<std::shared_ptr<const TCompiledProgram>> loaded;
+        loaded.reserve(file.Size());
+        for (size_t i = 0; i < file.Size(); i++) {
+            loaded.push_back(file.GetProgram(i));
+        }
+        bench::DoNotOptimize(loaded.back().get());
+    });
+
+    std::remove(path.c_str());
+}
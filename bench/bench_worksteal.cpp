@@ -0,0 +1,90 @@
+#include "bench.h"
+#include "TDynamicStack.h"
+#include "TWorkStealingDeque.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t kItems = 1 << 20;
+
+}
+
+// The owner's end of the deque against the plain stack it replaces: the
+// difference is the price of the fences that make stealing possible.
+BENCHMARK(WorkStealingOwner) {
+    bench::Measure("push+pop, TDynamicStack<size_t>", kItems, [] {
+        TDynamicStack<size_t, 64> stack;
+        size_t sum = 0;
+        for (size_t i = 0; i < kItems; i++) {
+            stack.Push(i);
+            if (i % 4 == 3) {
+                for (int k = 0; k < 4; k++) {
+                    sum += stack.PopUnchecked();
+                }
+            }
+        }
+        bench::DoNotOptimize(sum);
+    });
+
+    bench::Measure("push+pop, TWorkStealingDeque<size_t>", kItems, [] {
+        TWorkStealingDeque<size_t> deque;
+        size_t sum = 0;
+        size_t value = 0;
+        for (size_t i = 0; i < kItems; i++) {
+            deque.Push(i);
+            if (i % 4 == 3) {
+                for (int k = 0; k < 4; k++) {
+                    if (deque.TryPop(value)) {
+                        sum += value;
+                    }
+                }
+            }
+        }
+        bench::DoNotOptimize(sum);
+    });
+}
+
+// The owner pushes a stream of items while thieves drain the other end and
+// the owner takes what is left; the rate counts every item taken.
+BENCHMARK(WorkStealingSteal) {
+    for (size_t thieves : { 1, 2, 4, 7 }) {
+        size_t stolenTotal = 0;
+        bench::Measure("items, " + std::to_string(thieves) + " thieves", kItems, [&] {
+            TWorkStealingDeque<size_t> deque;
+            std::atomic<size_t> taken(0);
+            std::atomic<size_t> stolen(0);
+            std::vector<std::thread> threads;
+            for (size_t k = 0; k < thieves; k++) {
+                threads.emplace_back([&] {
+                    size_t value;
+                    size_t mine = 0;
+                    while (taken.load(std::memory_order_relaxed) < kItems) {
+                        if (deque.TrySteal(value)) {
+                            mine++;
+                            taken.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                    stolen += mine;
+                });
+            }
+
+            size_t value;
+            for (size_t i = 0; i < kItems; i++) {
+                deque.Push(i);
+            }
+            while (taken.load(std::memory_order_relaxed) < kItems) {
+                if (deque.TryPop(value)) {
+                    taken.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            for (std::thread& t : threads) {
+                t.join();
+            }
+            stolenTotal += stolen.load();
+        });
+        bench::DoNotOptimize(stolenTotal);
+    }
+}
@@ -0,0 +1,115 @@
+#include "counters.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#define BENCH_PERF_EVENTS 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+const char* const kCounterNames[COUNTER_KINDS] = {
+    "cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses"
+};
+
+#if BENCH_PERF_EVENTS
+namespace {
+
+int descriptors[COUNTER_KINDS] = { -1, -1, -1, -1, -1 };
+bool opened = false;
+
+uint64_t CacheMiss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+int Open(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+}
+
+bool OpenCounters(std::string& why) {
+    descriptors[CYCLES] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    int error = errno;
+    descriptors[INSTRUCTIONS] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    descriptors[BRANCH_MISSES] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    descriptors[L1D_MISSES] = Open(PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_L1D));
+    descriptors[LLC_MISSES] = Open(PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_LL));
+
+    for (int fd : descriptors) {
+        opened = opened || fd >= 0;
+    }
+    if (!opened) {
+        why = std::strerror(error);
+        if (error == EACCES || error == EPERM) {
+            why += " (see /proc/sys/kernel/perf_event_paranoid)";
+        }
+        else if (error == ENOENT || error == ENODEV || error == EOPNOTSUPP) {
+            why += " (no hardware PMU exposed, as in most containers and VMs)";
+        }
+    }
+    return opened;
+}
+
+bool CountersOpen() {
+    return opened;
+}
+
+void StartCounters() {
+    for (int fd : descriptors) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void StopCounters(double counts[COUNTER_KINDS]) {
+    for (int fd : descriptors) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int k = 0; k < COUNTER_KINDS; k++) {
+        // value, time enabled, time running
+        uint64_t data[3];
+        counts[k] = -1;
+        if (descriptors[k] >= 0 && read(descriptors[k], data, sizeof(data)) == sizeof(data) && data[2] > 0) {
+            counts[k] = static_cast<double>(data[0]) * data[1] / data[2];
+        }
+    }
+}
+#else
+bool OpenCounters(std::string& why) {
+    why = "perf_event_open is Linux only";
+    return false;
+}
+
+bool CountersOpen() {
+    return false;
+}
+
+void StartCounters() {}
+
+void StopCounters(double counts[COUNTER_KINDS]) {
+    for (int k = 0; k < COUNTER_KINDS; k++) {
+        counts[k] = -1;
+    }
+}
+#endif
+
+}
@@ -0,0 +1,30 @@
+#ifndef BENCH_COUNTERS_H
+#define BENCH_COUNTERS_H
+
+#include <string>
+
+namespace bench {
+
+// Hardware events read around every measurement when bench_calc runs with
+// --counters (Linux perf_event_open). Each event is opened on its own, so a
+// machine or container that lacks some of them still reports the rest.
+// Counts cover the thread that runs the benchmark body, in user space only;
+// work handed to other threads is not included.
+enum Counter { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, COUNTER_KINDS };
+
+extern const char* const kCounterNames[COUNTER_KINDS];
+
+// Opens the counters. Returns false and the reason when none is available.
+bool OpenCounters(std::string& why);
+
+bool CountersOpen();
+
+void StartCounters();
+
+// Stops counting and stores every event's count since StartCounters(),
+// scaled up if the kernel multiplexed it; negative for unavailable events.
+void StopCounters(double counts[COUNTER_KINDS]);
+
+}
+
+#endif
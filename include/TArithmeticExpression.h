@@ -2,50 +2,139 @@
 #define TARITHMETICEXPRESSION_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include "TDynamicStack.h"
+#include "TCompiledProgram.h"
 
 using namespace std;
 
+// Lexeme of an infix string. value is a slice of the string being compiled,
+// tokens do not outlive the compilation.
 struct Token {
     enum Type { OPERAND, OPERATOR, LEFT_PAREN, RIGHT_PAREN, NUMBER, FUNCTION_SIN, FUNCTION_COS };
     Type type;
-    string value;
-    double numValue;    
+    string_view value;
+    double numValue;
 
-    Token() : type(NUMBER), value(""), numValue(0) {}
+    Token() : type(NUMBER), numValue(0) {}
 
-    Token(Type t, const string& v = "") : type(t), value(v), numValue(0) {}
+    Token(Type t, string_view v = string_view(), double n = 0) : type(t), value(v), numValue(n) {}
 };
 
 class TArithmeticExpression
 {
-    string infix;
-    string postfix;
-    vector<Token> lexems; 
-    map<char, int> priority;
-    map<string, double> operands; 
+    pmr::string infix;
+    pmr::string postfix;
+    pmr::vector<pmr::string> operandNames;
+    pmr::vector<Instruction> code;
 
-    void Parse();
-    void ToPostfix();
+    shared_ptr<const TCompiledProgram> program;
+    TEvaluationContext context;
+    pmr::string optimizedPostfix;
+    size_t eliminatedOperations;
+    size_t deduplicatedNodes;
+
+    void Parse(pmr::vector<Token>& lexems);
+    void ToPostfix(const pmr::vector<Token>& lexems);
+    void Emit(const Token& token);
+    void Compile();
 
 public:
-    TArithmeticExpression(string infx);
+    // All memory of the expression, its compiled program and the temporary
+    // compilation state comes from `arena` when one is given, so request-scoped
+    // work can use a monotonic buffer and release it in one shot. Such an
+    // expression, and any copy sharing its program, must not outlive the arena.
+    // Copies of the expression itself use the default resource.
+    TArithmeticExpression(string infx, pmr::memory_resource* arena = nullptr);
 
     string GetInfix() const
     {
-        return infix;
+        return string(infix);
     }
 
     string GetPostfix() const
     {
-        return postfix;
+        return string(postfix);
+    }
+
+    // Postfix form of the program actually evaluated, after constant folding.
+    string GetOptimizedPostfix() const
+    {
+        return string(optimizedPostfix);
+    }
+
+    // Operations and function calls removed from the postfix form by the optimizer.
+    size_t GetEliminatedOperations() const
+    {
+        return eliminatedOperations;
+    }
+
+    // Repeated subexpressions that are computed once and reused.
+    size_t GetDeduplicatedNodes() const
+    {
+        return deduplicatedNodes;
+    }
+
+    // Immutable compiled form; copies of the expression share it.
+    shared_ptr<const TCompiledProgram> GetCompiledProgram() const
+    {
+        return program;
+    }
+
+    const pmr::vector<Instruction>& GetProgram() const
+    {
+        return program->GetCode();
+    }
+
+    size_t GetStackDepth() const
+    {
+        return program->GetStackDepth();
+    }
+
+    size_t GetTempCount() const
+    {
+        return program->GetTempCount();
+    }
+
+    // Empty error means the program is well formed.
+    const string& GetProgramError() const
+    {
+        return program->GetError();
     }
 
     vector<string> GetOperands() const;
+
+    // Approximate number of bytes held by the expression and its compiled program.
+    size_t GetMemoryUsage() const;
+
+    // Slot of a variable in GetOperands() order, or -1 if the expression has no such variable.
+    int GetOperandIndex(const string& name) const;
+
+    // Values set by name are remembered in the expression's own context, so these
+    // two must not be called concurrently on one object. All const methods may.
     double Calculate(const map<string, double>& values);
     double Calculate();
+
+    // Evaluation with values bound by slot: values[GetOperandIndex(name)].
+    // The pointer overload is unchecked and must cover all GetOperands().size() slots.
+    double Calculate(const double* values) const;
+    double Calculate(const vector<double>& values) const;
+
+    // Evaluation with the values and scratch memory of a caller-owned context.
+    double Calculate(TEvaluationContext& ctx) const;
+
+    // Columnar evaluation over `rows` rows: columns[slot] holds `rows` values of the
+    // variable with that slot, results go to out[0..rows). Each instruction is applied
+    // to a whole block of rows before the next one is dispatched.
+    void CalculateBatch(const double* const* columns, double* out, size_t rows) const;
+
+    // The same, with row ranges spread over the pool's workers. Each worker uses
+    // its own context, the program itself is only read.
+    void CalculateBatch(const double* const* columns, double* out, size_t rows, TThreadPool& pool) const;
 };
 
 #endif
\ No newline at end of file
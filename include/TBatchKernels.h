@@ -0,0 +1,35 @@
+#ifndef TBATCHKERNELS_H
+#define TBATCHKERNELS_H
+
+#include <cstddef>
+
+// Element-wise kernels behind TArithmeticExpression::CalculateBatch.
+// dst may be the same array as an input, but must not partially overlap it.
+//
+// + - * / give bit-identical results on every instruction set. The SIMD sin/cos
+// use their own range reduction and polynomials and stay within kSinCosMaxUlp
+// of std::sin/std::cos; arguments beyond kSinCosFastLimit, infinities and NaNs
+// are passed to libm.
+struct TBatchKernels {
+    enum Isa { SCALAR, SSE2, AVX2, AVX512 };
+
+    static constexpr int kSinCosMaxUlp = 3;
+    static constexpr double kSinCosFastLimit = 8.0e5;
+
+    Isa isa;
+    const char* name;
+    void (*add)(double* dst, const double* a, const double* b, size_t n);
+    void (*sub)(double* dst, const double* a, const double* b, size_t n);
+    void (*mul)(double* dst, const double* a, const double* b, size_t n);
+    // Returns false without a defined result if any divisor is zero.
+    bool (*div)(double* dst, const double* a, const double* b, size_t n);
+    void (*sin)(double* dst, const double* a, size_t n);
+    void (*cos)(double* dst, const double* a, size_t n);
+
+    // Kernels for the given instruction set, or nullptr if this build or CPU lacks it.
+    static const TBatchKernels* Get(Isa isa);
+    // The widest kernels the running CPU supports, detected once.
+    static const TBatchKernels& Best();
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TBATCHMODE_H
+#define TBATCHMODE_H
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "TExpressionCache.h"
+#include "TThreadPool.h"
+
+using namespace std;
+
+// Non-interactive evaluation of newline-delimited requests for `calc --batch`.
+// Each input line is an expression, optionally followed by ';' and bindings
+// separated by commas or blanks:
+//
+//     (a+b)*sin(c) ; a=1, b=2, c=0.5
+//
+// and produces exactly one output line, in input order: the result in the
+// shortest form that reads back to the same double, "error: <message>" when
+// the line cannot be evaluated, or an empty line for a blank one. Variables
+// without a binding are 0, as with Calculate(map).
+//
+// Lines are read in chunks; the lines of a chunk are evaluated on the pool,
+// each block of lines formatted into its own buffer, and the buffers written
+// out in order.
+class TBatchMode
+{
+public:
+    struct Stats {
+        size_t lines;
+        size_t errors;
+    };
+
+private:
+    TExpressionCache& cache;
+    TThreadPool& pool;
+    size_t chunkLines;
+    vector<string> lines;
+    vector<string> blocks;
+    vector<size_t> blockErrors;
+
+public:
+    static const size_t kBlockLines = 64;
+
+    TBatchMode(TExpressionCache& cache, TThreadPool& pool, size_t chunkLines = 16384);
+
+    TBatchMode(const TBatchMode&) = delete;
+    TBatchMode& operator=(const TBatchMode&) = delete;
+
+    // Evaluates every line of `in` and writes the results to `out`.
+    Stats Run(istream& in, ostream& out);
+
+    // Appends the output line for one input line, newline included, to `out`.
+    // Returns false if the line was an error.
+    static bool EvaluateLine(const string& line, TExpressionCache& cache, string& out);
+};
+
+#endif
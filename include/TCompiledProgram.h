@@ -0,0 +1,175 @@
+#ifndef TCOMPILEDPROGRAM_H
+#define TCOMPILEDPROGRAM_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class TThreadPool;
+class TEvaluationContext;
+
+// Single instruction of the compiled postfix program.
+// Literals are decoded once and variables are referenced by slot index,
+// so evaluation never touches strings. STORE_TEMP copies the top of the
+// stack into temporary `slot` without popping it, LOAD_TEMP pushes it back.
+struct Instruction {
+    enum OpCode { PUSH_NUMBER, PUSH_OPERAND, ADD, SUB, MUL, DIV, SIN, COS, STORE_TEMP, LOAD_TEMP };
+    OpCode op;
+    size_t slot;
+    double value;
+
+    Instruction(OpCode o, size_t s = 0, double v = 0) : op(o), slot(s), value(v) {}
+};
+
+// Immutable, validated instruction program with its variable table. All
+// evaluation methods are const and keep their mutable state in a
+// TEvaluationContext, so one program can be shared by any number of threads.
+class TCompiledProgram
+{
+    pmr::vector<Instruction> code;
+    // The instructions evaluated: code's, or ones owned by someone else.
+    const Instruction* instructions;
+    size_t instructionCount;
+    pmr::vector<pmr::string> operandNames;
+    size_t stackDepth;
+    size_t tempCount;
+    string error;
+
+    struct Range {
+        const Instruction* first;
+        const Instruction* last;
+        const Instruction* begin() const { return first; }
+        const Instruction* end() const { return last; }
+    };
+
+    Range Instructions() const
+    {
+        return Range{ instructions, instructions + instructionCount };
+    }
+
+    void Validate();
+    double Run(const double* values, double* scratch) const;
+
+public:
+    // Programs whose stack and temporaries fit in this many values are
+    // evaluated in a buffer on the call stack and never touch the context's scratch.
+    static constexpr size_t kLocalScratch = 64;
+
+    // operandNames must be sorted; PUSH_OPERAND slots index into it.
+    // The instructions and names are stored in memory from `resource`.
+    TCompiledProgram(pmr::vector<Instruction> instructions, const pmr::vector<pmr::string>& names,
+        pmr::memory_resource* resource = pmr::get_default_resource());
+
+    // A program over instructions it does not own, such as those of a mapped
+    // TProgramFile. They must stay valid and unchanged while the program
+    // exists; GetCode() is empty, GetInstructions() points at them.
+    TCompiledProgram(const Instruction* instructions, size_t count, const pmr::vector<pmr::string>& names,
+        pmr::memory_resource* resource = pmr::get_default_resource());
+
+    // Copies would point at the original's instructions; share programs instead.
+    TCompiledProgram(const TCompiledProgram&) = delete;
+    TCompiledProgram& operator=(const TCompiledProgram&) = delete;
+
+    // Instructions owned by the program.
+    const pmr::vector<Instruction>& GetCode() const
+    {
+        return code;
+    }
+
+    const Instruction* GetInstructions() const
+    {
+        return instructions;
+    }
+
+    size_t GetInstructionCount() const
+    {
+        return instructionCount;
+    }
+
+    const pmr::vector<pmr::string>& GetOperands() const
+    {
+        return operandNames;
+    }
+
+    // Slot of a variable, or -1 if the program has no such variable.
+    int GetOperandIndex(const string& name) const;
+
+    size_t GetStackDepth() const
+    {
+        return stackDepth;
+    }
+
+    size_t GetTempCount() const
+    {
+        return tempCount;
+    }
+
+    // Empty for a well-formed program; otherwise every evaluation throws it as runtime_error.
+    const string& GetError() const
+    {
+        return error;
+    }
+
+    // values[slot] for every variable; the stack and temporaries come from ctx
+    // when the program is too large for kLocalScratch. Neither allocates once
+    // ctx has been used with this program or was constructed for it.
+    double Evaluate(const double* values, TEvaluationContext& ctx) const;
+    // Evaluates with the values stored in ctx.
+    double Evaluate(TEvaluationContext& ctx) const;
+
+    // Columnar evaluation over `rows` rows: columns[slot] holds `rows` values of the
+    // variable with that slot, results go to out[0..rows). Each instruction is applied
+    // to a whole block of rows before the next one is dispatched.
+    void EvaluateBatch(const double* const* columns, double* out, size_t rows, TEvaluationContext& ctx) const;
+    // The same, with row ranges spread over the pool; every worker uses its own context.
+    void EvaluateBatch(const double* const* columns, double* out, size_t rows, TThreadPool& pool) const;
+};
+
+// Mutable evaluation state: variable values by slot plus the scratch memory for
+// the evaluation stack and temporaries. Cheap to create, grows on demand and
+// keeps its memory between evaluations; one context per thread.
+class TEvaluationContext
+{
+    pmr::vector<double> values;
+    pmr::vector<double> scratch;
+    pmr::vector<const double*> args;
+    // Column pointers shifted to the first row of a parallel chunk.
+    pmr::vector<const double*> columns;
+
+    friend class TCompiledProgram;
+
+public:
+    explicit TEvaluationContext(pmr::memory_resource* resource = pmr::get_default_resource())
+        : values(resource), scratch(resource), args(resource), columns(resource) {}
+
+    // Sized for the program's variables and evaluation stack, values start at 0.
+    explicit TEvaluationContext(const TCompiledProgram& program,
+        pmr::memory_resource* resource = pmr::get_default_resource());
+
+    // Sizes the values and scratch for the program, so that evaluating it
+    // does not allocate.
+    void Reserve(const TCompiledProgram& program);
+
+    void SetValue(size_t slot, double value)
+    {
+        if (slot >= values.size()) {
+            values.resize(slot + 1, 0.0);
+        }
+        values[slot] = value;
+    }
+
+    double GetValue(size_t slot) const
+    {
+        return slot < values.size() ? values[slot] : 0.0;
+    }
+
+    const pmr::vector<double>& GetValues() const
+    {
+        return values;
+    }
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef TDATASET_H
+#define TDATASET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TArithmeticExpression.h"
+#include "TMappedFile.h"
+#include "TThreadPool.h"
+
+using namespace std;
+
+// A table of doubles read through a memory-mapped file, for evaluating one
+// expression over every row without loading the table into the heap.
+//
+// Two formats are recognised by their first bytes:
+//
+// - CSV: a header line naming the columns, then one row of numbers per line.
+//   Blank lines are skipped. Rows are parsed in blocks of kBlockRows straight
+//   from the mapping into small per-thread buffers.
+//
+// - Columnar (native byte order): the 8-byte magic "CALCCOLS", uint32 version
+//   (1), uint32 column count, uint64 row count; per column a uint32 name
+//   length and the name; zero padding to a multiple of 8; then each column's
+//   values as consecutive doubles. Columns are used in place.
+class TDataset
+{
+    TMappedFile file;
+    bool columnar;
+    size_t rows;
+    vector<string> names;
+    // Columnar: start of the first column. CSV: offset of the first data line.
+    size_t dataOffset;
+    // CSV: offset of the first line of every block of kBlockRows rows.
+    vector<size_t> blockOffsets;
+
+    void OpenColumnar();
+    void OpenCsv();
+    void ParseCsvBlock(size_t block, double* const* dst) const;
+
+public:
+    static const size_t kBlockRows = 4096;
+
+    // Maps the file and validates its layout; throws runtime_error if the
+    // file cannot be read or is malformed.
+    explicit TDataset(const string& path);
+
+    size_t GetRows() const
+    {
+        return rows;
+    }
+
+    const vector<string>& GetColumnNames() const
+    {
+        return names;
+    }
+
+    bool IsColumnar() const
+    {
+        return columnar;
+    }
+
+    // Index of the named column, or -1.
+    int GetColumnIndex(const string& name) const;
+
+    // Values of a column of a columnar dataset, in the mapping; nullptr for CSV.
+    const double* GetColumn(size_t index) const;
+
+    // Evaluates expr for every row into out[0..GetRows()). Every operand of
+    // expr must name a column; other columns are ignored.
+    void Evaluate(const TArithmeticExpression& expr, double* out, TThreadPool& pool) const;
+
+    // The same, writing the results to a columnar file with one column named
+    // "result" that is mapped and filled in place.
+    void Evaluate(const TArithmeticExpression& expr, const string& outputPath, TThreadPool& pool) const;
+
+    // Writes the whole dataset as a columnar file.
+    void WriteColumnar(const string& outputPath, TThreadPool& pool) const;
+
+    // Writes `rows` rows of the given columns as a columnar file.
+    static void WriteColumnar(const string& outputPath, const vector<string>& names,
+        const double* const* columns, size_t rows);
+};
+
+#endif
@@ -2,70 +2,295 @@
 #define TDYNAMICSTACK_H
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory_resource>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "TInstrumentation.h"
 
-template<typename T>
+// Growth policy: capacity becomes capacity * Numerator / Denominator, and at
+// least one element more, whenever a push finds the stack full.
+template<size_t Numerator = 2, size_t Denominator = 1>
+struct TGeometricGrowth {
+    static_assert(Numerator > Denominator, "Growth factor must be greater than 1");
+
+    static size_t Next(size_t capacity) {
+        return std::max(capacity * Numerator / Denominator, capacity + 1);
+    }
+};
+
+// Stack with room for N elements inside the object itself; only deeper stacks
+// go to the heap. Elements are constructed on push and destroyed on pop, never
+// default-constructed. Heap storage comes from malloc, where trivially copyable
+// elements grow with realloc, or from a memory_resource given at construction.
+template<typename T, size_t N = 1, typename Growth = TGeometricGrowth<>>
 class TDynamicStack {
 private:
-    int top;
-    size_t memSize;
+    static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned element types are not supported");
+
+    static constexpr bool kTrivial = std::is_trivially_copyable<T>::value;
+
     T* pMem;
+    size_t count;
+    size_t memSize;
+    std::pmr::memory_resource* resource;
+    alignas(T) unsigned char local[(N > 0 ? N : 1) * sizeof(T)];
+
+    T* Local() {
+        return reinterpret_cast<T*>(local);
+    }
+
+    bool IsLocal() const {
+        return pMem == reinterpret_cast<const T*>(local);
+    }
+
+    T* Allocate(size_t n) {
+        if (resource) {
+            return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+        }
+        void* p = std::malloc(n * sizeof(T));
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    void Deallocate(T* p, size_t n) {
+        if (resource) {
+            resource->deallocate(p, n * sizeof(T), alignof(T));
+        }
+        else {
+            std::free(p);
+        }
+    }
+
+    void Destroy() {
+        if constexpr (!kTrivial) {
+            for (size_t i = 0; i < count; i++) {
+                pMem[i].~T();
+            }
+        }
+        count = 0;
+    }
+
+    void Release() {
+        if (!IsLocal()) {
+            Deallocate(pMem, memSize);
+        }
+        pMem = Local();
+        memSize = N;
+    }
+
+    void Relocate(size_t newSize) {
+        CALC_COUNT(STACK_GROWTHS, 1);
+        if constexpr (kTrivial) {
+            if (!IsLocal() && !resource) {
+                void* p = std::realloc(pMem, newSize * sizeof(T));
+                if (!p) {
+                    throw std::bad_alloc();
+                }
+                pMem = static_cast<T*>(p);
+                memSize = newSize;
+                return;
+            }
+        }
+        T* tmpMem = Allocate(newSize);
+        if constexpr (kTrivial) {
+            std::memcpy(static_cast<void*>(tmpMem), pMem, count * sizeof(T));
+        }
+        else {
+            size_t built = 0;
+            try {
+                for (; built < count; built++) {
+                    new (tmpMem + built) T(std::move_if_noexcept(pMem[built]));
+                }
+            }
+            catch (...) {
+                while (built > 0) {
+                    tmpMem[--built].~T();
+                }
+                Deallocate(tmpMem, newSize);
+                throw;
+            }
+            for (size_t i = 0; i < count; i++) {
+                pMem[i].~T();
+            }
+        }
+        if (!IsLocal()) {
+            Deallocate(pMem, memSize);
+        }
+        pMem = tmpMem;
+        memSize = newSize;
+    }
+
+    // Slow path of a push into a full stack. The new element is built before
+    // the storage moves, since the arguments may refer to an element.
+    template<typename... Args>
+    T& EmplaceGrow(Args&&... args) {
+        T value(std::forward<Args>(args)...);
+        Relocate(Growth::Next(memSize));
+        new (pMem + count) T(std::move(value));
+        CALC_HIGH_WATER(STACK_HIGH_WATER, count + 1);
+        return pMem[count++];
+    }
+
+    // Heap storage is taken over when both stacks use the same memory resource;
+    // otherwise the elements are moved one by one.
+    void MoveFrom(TDynamicStack& other) {
+        if (other.IsLocal() || resource != other.resource) {
+            reserve(other.count);
+            for (size_t i = 0; i < other.count; i++) {
+                new (pMem + i) T(std::move(other.pMem[i]));
+            }
+            count = other.count;
+            other.Destroy();
+        }
+        else {
+            pMem = other.pMem;
+            count = other.count;
+            memSize = other.memSize;
+            other.pMem = other.Local();
+            other.count = 0;
+            other.memSize = N;
+        }
+    }
 
 public:
-    TDynamicStack(size_t _memSize = 1) :
-        top(-1), memSize(_memSize), pMem(new T[memSize]) {
+    TDynamicStack(size_t _memSize = 1, std::pmr::memory_resource* _resource = nullptr) :
+        pMem(Local()), count(0), memSize(N), resource(_resource) {
+        reserve(_memSize);
+    }
+
+    // Copies use malloc, like copies of std::pmr containers use the default
+    // resource; moves keep the resource of the source.
+    TDynamicStack(const TDynamicStack& other) :
+        TDynamicStack(other.memSize) {
+        for (size_t i = 0; i < other.count; i++) {
+            new (pMem + i) T(other.pMem[i]);
+            count++;
+        }
+    }
+
+    TDynamicStack(TDynamicStack&& other) noexcept(std::is_nothrow_move_constructible<T>::value) :
+        pMem(Local()), count(0), memSize(N), resource(other.resource) {
+        MoveFrom(other);
+    }
+
+    TDynamicStack& operator=(const TDynamicStack& other) {
+        if (this != &other) {
+            Destroy();
+            reserve(other.count);
+            for (size_t i = 0; i < other.count; i++) {
+                new (pMem + i) T(other.pMem[i]);
+                count++;
+            }
+        }
+        return *this;
+    }
+
+    // May allocate, when the stacks use different memory resources.
+    TDynamicStack& operator=(TDynamicStack&& other) {
+        if (this != &other) {
+            Destroy();
+            Release();
+            MoveFrom(other);
+        }
+        return *this;
     }
 
     ~TDynamicStack() {
-        delete[] pMem;
+        Destroy();
+        Release();
     }
 
     size_t size() const {
-        return top + 1;
+        return count;
+    }
+
+    size_t capacity() const {
+        return memSize;
+    }
+
+    std::pmr::memory_resource* GetResource() const {
+        return resource;
     }
 
     bool IsEmpty() const {
-        return top == -1;
+        return count == 0;
     }
 
     bool IsFull() const {
-        return top == static_cast<int>(memSize) - 1;
+        return count == memSize;
+    }
+
+    // Makes room for n elements without further allocation.
+    void reserve(size_t n) {
+        if (n > memSize) {
+            Relocate(n);
+        }
+    }
+
+    void clear() {
+        Destroy();
     }
 
     T Pop() {
         if (IsEmpty()) {
             throw std::underflow_error("Stack is empty");
         }
-        return pMem[top--];
+        return PopUnchecked();
+    }
+
+    // For loops whose stack use was validated up front: the stack must not be empty.
+    T PopUnchecked() {
+        T value(std::move(pMem[count - 1]));
+        pMem[--count].~T();
+        return value;
     }
 
     void Push(const T& val) {
-        if (IsFull()) {
-            size_t newSize = memSize * 2;
-            T* tmpMem = new T[newSize];
+        Emplace(val);
+    }
 
-            std::copy(pMem, pMem + memSize, tmpMem);
+    void Push(T&& val) {
+        Emplace(std::move(val));
+    }
 
-            delete[] pMem;
-            pMem = tmpMem;
-            memSize = newSize;
+    template<typename... Args>
+    T& Emplace(Args&&... args) {
+        if (IsFull()) {
+            return EmplaceGrow(std::forward<Args>(args)...);
         }
-        pMem[++top] = val;
+        new (pMem + count) T(std::forward<Args>(args)...);
+        CALC_HIGH_WATER(STACK_HIGH_WATER, count + 1);
+        return pMem[count++];
     }
 
     T& Top() {
         if (IsEmpty()) {
             throw std::underflow_error("Stack is empty");
         }
-        return pMem[top];
+        return pMem[count - 1];
     }
 
     const T& Top() const {
         if (IsEmpty()) {
             throw std::underflow_error("Stack is empty");
         }
-        return pMem[top];
+        return pMem[count - 1];
+    }
+
+    T& TopUnchecked() {
+        return pMem[count - 1];
+    }
+
+    const T& TopUnchecked() const {
+        return pMem[count - 1];
     }
 };
 
-#endif
\ No newline at end of file
+#endif
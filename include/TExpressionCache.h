@@ -0,0 +1,78 @@
+#ifndef TEXPRESSIONCACHE_H
+#define TEXPRESSIONCACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TArithmeticExpression.h"
+
+using namespace std;
+
+// Bounded LRU cache of compiled expressions keyed by normalized infix text.
+// Entries are spread over independently locked shards, each holding an equal
+// part of the memory budget. Handed-out expressions are shared and const:
+// evaluate them through the const Calculate overloads, or copy them (copies
+// share the compiled program) to use the map-based Calculate().
+class TExpressionCache
+{
+public:
+    struct Stats {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+        size_t entries;
+        size_t bytes;
+    };
+
+private:
+    typedef shared_ptr<const TArithmeticExpression> Handle;
+
+    struct Entry {
+        string key;
+        Handle expr;
+        size_t bytes;
+    };
+
+    struct Shard {
+        mutex lock;
+        list<Entry> lru;    // most recently used first
+        unordered_map<string, list<Entry>::iterator> index;
+        size_t bytes;
+    };
+
+    vector<unique_ptr<Shard>> shards;
+    size_t shardBudget;
+    atomic<size_t> hits;
+    atomic<size_t> misses;
+    atomic<size_t> evictions;
+
+    Shard& ShardFor(const string& key);
+
+public:
+    explicit TExpressionCache(size_t memoryBudget = 64 << 20, size_t shardCount = 16);
+
+    TExpressionCache(const TExpressionCache&) = delete;
+    TExpressionCache& operator=(const TExpressionCache&) = delete;
+
+    // The compiled expression for infix, compiling and caching it on a miss.
+    // Parse errors are thrown as by the TArithmeticExpression constructor and
+    // are not cached. On a hit GetInfix() returns the text first seen for the key.
+    Handle Get(const string& infix);
+
+    Stats GetStats() const;
+    void Clear();
+
+    // Drops whitespace that cannot change the meaning: a single space is kept
+    // only where two names or numbers would otherwise run together.
+    static string Normalize(const string& infix);
+
+    // Shared instance used by the calc tool.
+    static TExpressionCache& Global();
+};
+
+#endif
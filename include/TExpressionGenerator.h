@@ -0,0 +1,75 @@
+#ifndef TEXPRESSIONGENERATOR_H
+#define TEXPRESSIONGENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// xoshiro256** (Blackman and Vigna) seeded through splitmix64. Only integer
+// operations with fixed widths are used, so a seed gives the same stream on
+// every platform and compiler.
+class TRandom
+{
+    uint64_t state[4];
+
+public:
+    explicit TRandom(uint64_t seed);
+
+    uint64_t Next();
+
+    // Uniform in [0, 1), 53 random bits.
+    double Uniform();
+
+    // Uniform in [0, n), n > 0, without modulo bias.
+    uint64_t Below(uint64_t n);
+};
+
+// Seeded generator of random well-formed expressions for benchmarks and
+// stress tests. The same options always give the same text.
+class TExpressionGenerator
+{
+public:
+    struct Options {
+        uint64_t seed = 1;
+        size_t tokens = 64;             // approximate number of lexemes
+        size_t maxDepth = 8;            // deepest parenthesis nesting
+        size_t variables = 4;           // distinct single-letter variables, 0..26
+        double literalDensity = 0.3;    // share of leaves that are numbers
+        double trigFrequency = 0.1;     // share of operands that are sin/cos calls
+        double groupFrequency = 0.2;    // share of operands that are parenthesised
+        double operatorWeights[4] = { 1, 1, 1, 1 };  // relative weights of + - * /
+    };
+
+private:
+    Options options;
+    TRandom random;
+    double weightTotal;
+
+    void AppendLiteral(string& out);
+    char PickOperator();
+
+public:
+    explicit TExpressionGenerator(const Options& options);
+
+    // The next expression: options.tokens tokens, or one fewer when the last
+    // operator would have no operand. Generation is iterative, so millions of
+    // tokens are fine. Divisors are always single variables or non-zero
+    // literals, so evaluation with non-zero variable values cannot divide by zero.
+    string Next();
+
+    // Variable names the generator draws from: the first options.variables
+    // letters of the alphabet. A given expression may use fewer.
+    vector<string> GetVariables() const;
+
+    // `rows` values for each of `variables` columns, uniform in [low, high).
+    static vector<vector<double>> GenerateColumns(size_t variables, size_t rows, uint64_t seed,
+        double low = 0.5, double high = 2.0);
+
+    // Number of lexemes of an expression, counted as the parser splits it.
+    static size_t CountTokens(const string& expression);
+};
+
+#endif
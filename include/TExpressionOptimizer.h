@@ -0,0 +1,76 @@
+#ifndef TEXPRESSIONOPTIMIZER_H
+#define TEXPRESSIONOPTIMIZER_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+#include "TCompiledProgram.h"
+
+using namespace std;
+
+// Rebuilds a well-formed instruction program as a hash-consed DAG and rewrites
+// it into an equivalent shorter program. Only rewrites that give bit-identical
+// IEEE results are applied:
+//   - operations whose arguments are all literals are evaluated, except
+//     division by a literal zero, which must still fail at evaluation time;
+//   - x*1, 1*x, x/1, x-0, x+(-0) and (-0)+x become x;
+//   - structurally equal subexpressions (a+b and b+a, a*b and b*a included)
+//     become one node, computed once into a temporary and reloaded after that.
+// x+0, 0*x and x-x are left alone: they differ from x (or 0) for -0, inf or NaN.
+class TExpressionOptimizer
+{
+    struct Node {
+        Instruction::OpCode op;
+        size_t left;
+        size_t right;
+        size_t slot;
+        double value;
+    };
+
+    struct NodeKey {
+        Instruction::OpCode op;
+        size_t left;
+        size_t right;
+        uint64_t bits;
+
+        bool operator==(const NodeKey& other) const
+        {
+            return op == other.op && left == other.left && right == other.right && bits == other.bits;
+        }
+    };
+
+    struct Entry {
+        NodeKey key;
+        size_t id;
+    };
+
+    pmr::vector<Node> nodes;
+    // Open-addressing table with linear probing. Every instruction adds at
+    // most one node, so it is sized once for the program and never rehashed.
+    pmr::vector<Entry> unique;
+    size_t mask;
+    size_t root;
+    size_t deduplicated;
+
+    static size_t HashKey(const NodeKey& key);
+    size_t AddNode(Instruction::OpCode op, size_t left, size_t right, size_t slot, double value);
+    size_t MakeLiteral(double value);
+    size_t MakeUnary(Instruction::OpCode op, size_t arg);
+    size_t MakeBinary(Instruction::OpCode op, size_t left, size_t right);
+    bool IsLiteral(size_t node, double value) const;
+
+public:
+    // The node tables and the rewritten program are allocated from `resource`.
+    explicit TExpressionOptimizer(const pmr::vector<Instruction>& program,
+        pmr::memory_resource* resource = pmr::get_default_resource());
+
+    pmr::vector<Instruction> GetProgram() const;
+
+    // Operations that were found to repeat an existing node and were shared.
+    size_t GetDeduplicatedNodes() const
+    {
+        return deduplicated;
+    }
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef TINSTRUMENTATION_H
+#define TINSTRUMENTATION_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Hot-path instrumentation, compiled in only when the library is configured
+// with -DCALC_INSTRUMENTATION=ON. Without it the CALC_* macros below expand
+// to nothing and the queries report zeros.
+//
+// Every thread counts into its own block, so recording needs no locks or
+// atomic read-modify-writes; Take() adds the blocks of all live threads
+// and of the threads that have exited. Phases record a call count and the
+// total time spent in them. While tracing is on, every phase call is also
+// kept as a Chrome trace event ("X" phase, microseconds), which
+// chrome://tracing and Perfetto display as a timeline.
+class TInstrumentation
+{
+public:
+    enum Phase { PARSE, TO_POSTFIX, COMPILE, EVALUATE, EVALUATE_BATCH, PHASE_COUNT };
+
+    // STACK_HIGH_WATER is a maximum over all threads; the others are sums.
+    enum Counter { EXPRESSIONS, TOKENS, BATCH_ROWS, STACK_GROWTHS, STACK_HIGH_WATER, COUNTER_COUNT };
+
+    struct Snapshot {
+        uint64_t calls[PHASE_COUNT];
+        uint64_t nanoseconds[PHASE_COUNT];
+        uint64_t counters[COUNTER_COUNT];
+    };
+
+    static const char* const kPhaseNames[PHASE_COUNT];
+    static const char* const kCounterNames[COUNTER_COUNT];
+
+    static bool Enabled()
+    {
+#if CALC_INSTRUMENTATION
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static Snapshot Take();
+    // Zeroes the counters of every thread. Updates that other threads make
+    // while it runs may survive it.
+    static void Reset();
+
+    static void WriteText(std::ostream& out, const Snapshot& snapshot);
+    static void WriteJson(std::ostream& out, const Snapshot& snapshot);
+
+    // Trace events are collected between StartTrace() and StopTrace() and
+    // kept until Reset(); WriteTrace() writes them as a Chrome trace file.
+    static void StartTrace();
+    static void StopTrace();
+    static void WriteTrace(std::ostream& out);
+
+    // Recording, normally through the macros.
+    static void Add(Counter counter, uint64_t n);
+    static void Max(Counter counter, uint64_t value);
+    static void AddPhase(Phase phase, std::chrono::steady_clock::time_point start,
+        std::chrono::steady_clock::time_point end);
+
+    class Scope
+    {
+        Phase phase;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit Scope(Phase p) : phase(p), start(std::chrono::steady_clock::now()) {}
+
+        ~Scope()
+        {
+            AddPhase(phase, start, std::chrono::steady_clock::now());
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+#define CALC_INSTRUMENTATION_CONCAT2(a, b) a##b
+#define CALC_INSTRUMENTATION_CONCAT(a, b) CALC_INSTRUMENTATION_CONCAT2(a, b)
+
+#if CALC_INSTRUMENTATION
+// Times the rest of the enclosing block as the given phase.
+#define CALC_PHASE(phase) \
+    TInstrumentation::Scope CALC_INSTRUMENTATION_CONCAT(calcPhase, __LINE__)(TInstrumentation::phase)
+#define CALC_COUNT(counter, n) TInstrumentation::Add(TInstrumentation::counter, (n))
+#define CALC_HIGH_WATER(counter, value) TInstrumentation::Max(TInstrumentation::counter, (value))
+#else
+#define CALC_PHASE(phase) ((void)0)
+#define CALC_COUNT(counter, n) ((void)0)
+#define CALC_HIGH_WATER(counter, value) ((void)0)
+#endif
+
+#endif
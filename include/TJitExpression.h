@@ -0,0 +1,60 @@
+#ifndef TJITEXPRESSION_H
+#define TJITEXPRESSION_H
+
+#include <cstddef>
+#include <string>
+#include "TArithmeticExpression.h"
+
+using namespace std;
+
+// Native x86-64 code for a compiled TArithmeticExpression. Stack slot i of the
+// program lives in register xmm<i>, literals sit in a pool after the code and
+// sin/cos are calls into libm. When the target is not x86-64 Linux, the program
+// is malformed, needs more than kMaxRegisters stack slots or more than kMaxTemps
+// temporaries, Calculate() falls back to the interpreter.
+class TJitExpression
+{
+    typedef double (*Function)(const double* values, int* status);
+
+    TArithmeticExpression expr;
+    void* code;
+    size_t codeSize;
+    Function function;
+
+    void Compile(bool writePerfMap);
+
+public:
+    static constexpr size_t kMaxRegisters = 14;
+    static constexpr size_t kMaxTemps = 4096;
+
+    // With writePerfMap the code range is appended to /tmp/perf-<pid>.map,
+    // so that perf can attribute samples to it.
+    explicit TJitExpression(const TArithmeticExpression& expression, bool writePerfMap = false);
+    ~TJitExpression();
+
+    TJitExpression(const TJitExpression&) = delete;
+    TJitExpression& operator=(const TJitExpression&) = delete;
+
+    // True if this build can generate native code at all.
+    static bool IsSupported();
+
+    bool IsCompiled() const
+    {
+        return function != nullptr;
+    }
+
+    size_t GetCodeSize() const
+    {
+        return codeSize;
+    }
+
+    const TArithmeticExpression& GetExpression() const
+    {
+        return expr;
+    }
+
+    // values[slot] as in TArithmeticExpression::Calculate(const double*).
+    double Calculate(const double* values) const;
+};
+
+#endif
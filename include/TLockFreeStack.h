@@ -0,0 +1,155 @@
+#ifndef TLOCKFREESTACK_H
+#define TLOCKFREESTACK_H
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Lock-free (Treiber) stack for handing values between threads, with the
+// Push/Pop/IsEmpty interface of TDynamicStack.
+//
+// The top of the stack is a tagged pointer: the node address in the low 48
+// bits and a counter in the upper 16 bits, bumped by every successful
+// exchange, so a node that was popped and pushed again between another
+// thread's load and compare-exchange (ABA) makes that exchange fail. Popped
+// nodes go to an internal free list of the same kind and are reused by later
+// pushes; they are only freed by the destructor, so a thread that still reads
+// a node another thread has popped never touches freed memory.
+template<typename T>
+class TLockFreeStack {
+private:
+    static_assert(sizeof(void*) == 8, "Tagged pointers need a 64-bit address space");
+
+    struct Node {
+        std::atomic<Node*> next;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* Value() {
+            return reinterpret_cast<T*>(storage);
+        }
+    };
+
+    static constexpr uint64_t kPointerMask = (uint64_t(1) << 48) - 1;
+
+    std::atomic<uint64_t> top;
+    std::atomic<uint64_t> freeList;
+
+    static Node* PointerOf(uint64_t tagged) {
+        return reinterpret_cast<Node*>(tagged & kPointerMask);
+    }
+
+    static uint64_t Tagged(Node* node, uint64_t previous) {
+        return ((previous >> 48) + 1) << 48 | reinterpret_cast<uint64_t>(node);
+    }
+
+    static void PushNode(std::atomic<uint64_t>& head, Node* node) {
+        uint64_t old = head.load(std::memory_order_relaxed);
+        do {
+            node->next.store(PointerOf(old), std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(old, Tagged(node, old),
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    static Node* PopNode(std::atomic<uint64_t>& head) {
+        uint64_t old = head.load(std::memory_order_acquire);
+        while (Node* node = PointerOf(old)) {
+            // node may be popped and reused concurrently; then the tag has
+            // changed and the exchange fails, whatever next was read.
+            Node* next = node->next.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old, Tagged(next, old),
+                std::memory_order_acquire, std::memory_order_acquire)) {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    Node* NewNode() {
+        Node* node = PopNode(freeList);
+        if (!node) {
+            node = new Node;
+            if (reinterpret_cast<uint64_t>(node) & ~kPointerMask) {
+                delete node;
+                throw std::bad_alloc();
+            }
+        }
+        return node;
+    }
+
+public:
+    TLockFreeStack() : top(0), freeList(0) {}
+
+    TLockFreeStack(const TLockFreeStack&) = delete;
+    TLockFreeStack& operator=(const TLockFreeStack&) = delete;
+
+    // Must not run concurrently with any other member.
+    ~TLockFreeStack() {
+        while (Node* node = PopNode(top)) {
+            node->Value()->~T();
+            delete node;
+        }
+        while (Node* node = PopNode(freeList)) {
+            delete node;
+        }
+    }
+
+    // A snapshot: other threads may push or pop right after it is taken.
+    bool IsEmpty() const {
+        return PointerOf(top.load(std::memory_order_acquire)) == nullptr;
+    }
+
+    void Push(const T& val) {
+        Emplace(val);
+    }
+
+    void Push(T&& val) {
+        Emplace(std::move(val));
+    }
+
+    template<typename... Args>
+    void Emplace(Args&&... args) {
+        Node* node = NewNode();
+        try {
+            new (node->storage) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            PushNode(freeList, node);
+            throw;
+        }
+        PushNode(top, node);
+    }
+
+    T Pop() {
+        Node* node = PopNode(top);
+        if (!node) {
+            throw std::underflow_error("Stack is empty");
+        }
+        try {
+            T value(std::move(*node->Value()));
+            node->Value()->~T();
+            PushNode(freeList, node);
+            return value;
+        }
+        catch (...) {
+            PushNode(top, node);
+            throw;
+        }
+    }
+
+    // Moves the top element into `out`; returns false if the stack was empty.
+    bool TryPop(T& out) noexcept(std::is_nothrow_move_assignable<T>::value) {
+        Node* node = PopNode(top);
+        if (!node) {
+            return false;
+        }
+        out = std::move(*node->Value());
+        node->Value()->~T();
+        PushNode(freeList, node);
+        return true;
+    }
+};
+
+#endif
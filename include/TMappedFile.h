@@ -0,0 +1,47 @@
+#ifndef TMAPPEDFILE_H
+#define TMAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+// A whole file mapped into memory (POSIX mmap). Opening or creating a file on
+// a platform without mmap throws runtime_error.
+class TMappedFile
+{
+    char* data;
+    size_t size;
+
+    void Release();
+
+public:
+    // Maps an existing file read-only.
+    explicit TMappedFile(const string& path);
+    // Creates (or truncates) the file with `size` bytes and maps it writable;
+    // what is written to Data() ends up in the file.
+    TMappedFile(const string& path, size_t size);
+    ~TMappedFile();
+
+    TMappedFile(TMappedFile&& other) noexcept;
+    TMappedFile& operator=(TMappedFile&& other) noexcept;
+    TMappedFile(const TMappedFile&) = delete;
+    TMappedFile& operator=(const TMappedFile&) = delete;
+
+    const char* Data() const
+    {
+        return data;
+    }
+
+    char* Data()
+    {
+        return data;
+    }
+
+    size_t Size() const
+    {
+        return size;
+    }
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef TPROGRAMFILE_H
+#define TPROGRAMFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "TCompiledProgram.h"
+#include "TMappedFile.h"
+
+using namespace std;
+
+// A file of compiled programs that loads by mapping it: programs evaluate
+// their instructions straight from the mapping, with no parsing and no copy.
+//
+// Layout, all offsets from the start of the file and all values in the
+// writer's byte order:
+//
+//     header     "CALCPROG", uint32 version (1), uint32 byte-order mark
+//                0x01020304, uint32 sizeof(Instruction), uint32 program
+//                count, uint64 file size
+//     directory  one Entry per program
+//     data       per program, 8-byte aligned: its Instruction array as laid
+//                out in memory, its variable names (uint32 length + bytes,
+//                sorted), and optionally its source text
+//
+// Files are only readable on platforms with the same byte order and
+// Instruction layout as the writer's. Every offset, count and instruction is
+// checked before use, so a truncated or hostile file throws runtime_error
+// instead of being read out of bounds.
+class TProgramFile
+{
+public:
+    struct Entry {
+        uint64_t codeOffset;
+        uint64_t codeCount;
+        uint64_t namesOffset;
+        uint64_t sourceOffset;
+        uint32_t namesSize;
+        uint32_t nameCount;
+        uint32_t sourceLength;
+        uint32_t reserved;
+    };
+
+private:
+    shared_ptr<const TMappedFile> file;
+    size_t count;
+
+    Entry GetEntry(size_t index) const;
+
+public:
+    // Maps the file and checks its header and directory.
+    explicit TProgramFile(const string& path);
+
+    size_t Size() const
+    {
+        return count;
+    }
+
+    // The program at `index`, over the mapped instructions. Its variable
+    // names are copied into `resource`. The instructions are validated like
+    // any program's and a malformed one throws. Programs keep the mapping
+    // alive, so they may outlive this object.
+    shared_ptr<const TCompiledProgram> GetProgram(size_t index,
+        pmr::memory_resource* resource = pmr::get_default_resource()) const;
+
+    // Source text stored with the program, empty if none was.
+    string_view GetSource(size_t index) const;
+
+    // Writes well-formed programs, with sources[i] as the text of programs[i]
+    // when sources is not empty.
+    static void Write(const string& path, const vector<shared_ptr<const TCompiledProgram>>& programs,
+        const vector<string>& sources = vector<string>());
+};
+
+#endif
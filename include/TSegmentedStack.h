@@ -0,0 +1,286 @@
+#ifndef TSEGMENTEDSTACK_H
+#define TSEGMENTEDSTACK_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include "TInstrumentation.h"
+
+// Stack built from linked fixed-size chunks. A push never moves existing
+// elements, so references to them stay valid and the cost of a push does not
+// depend on the depth. The last chunk left by popping is kept as a spare, so a
+// stack that goes up and down across a chunk boundary does not allocate.
+// Chunks come from the global heap, or from a memory_resource given at construction.
+template<typename T, size_t ChunkSize = 256>
+class TSegmentedStack {
+private:
+    static_assert(ChunkSize > 0, "Chunks must hold at least one element");
+
+    struct Chunk {
+        Chunk* prev;
+        Chunk* next;
+        alignas(T) unsigned char data[ChunkSize * sizeof(T)];
+
+        T* At(size_t i) {
+            return reinterpret_cast<T*>(data) + i;
+        }
+    };
+
+    // top is the chunk holding the top element; it only has index == 0 while
+    // the stack is empty. top->next is the spare chunk, if any.
+    Chunk* top;
+    size_t index;
+    size_t count;
+    size_t chunks;
+    std::pmr::memory_resource* resource;
+
+    Chunk* NewChunk() {
+        if (resource) {
+            return new (resource->allocate(sizeof(Chunk), alignof(Chunk))) Chunk;
+        }
+        return new Chunk;
+    }
+
+    void DeleteChunk(Chunk* chunk) {
+        if (resource) {
+            resource->deallocate(chunk, sizeof(Chunk), alignof(Chunk));
+        }
+        else {
+            delete chunk;
+        }
+    }
+
+    void Advance() {
+        if (top && top->next) {
+            top = top->next;
+        }
+        else {
+            Chunk* chunk = NewChunk();
+            chunk->prev = top;
+            chunk->next = nullptr;
+            if (top) {
+                top->next = chunk;
+            }
+            top = chunk;
+            chunks++;
+            CALC_COUNT(STACK_GROWTHS, 1);
+        }
+        index = 0;
+    }
+
+    // Called once the top chunk has become empty: it turns into the spare and
+    // the previous spare is freed.
+    void Retreat() {
+        if (top->next) {
+            DeleteChunk(top->next);
+            top->next = nullptr;
+            chunks--;
+        }
+        top = top->prev;
+        index = ChunkSize;
+    }
+
+    // Slow path of a push that starts a chunk. If the element cannot be
+    // constructed, the full chunk becomes the top again.
+    template<typename... Args>
+    T& EmplaceAdvance(Args&&... args) {
+        Advance();
+        T* slot;
+        try {
+            slot = new (top->At(0)) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            if (top->prev) {
+                top = top->prev;
+                index = ChunkSize;
+            }
+            throw;
+        }
+        index = 1;
+        count++;
+        CALC_HIGH_WATER(STACK_HIGH_WATER, count);
+        return *slot;
+    }
+
+    void DestroyTop() {
+        top->At(--index)->~T();
+        count--;
+        if (index == 0 && top->prev) {
+            Retreat();
+        }
+    }
+
+    void Free() {
+        clear();
+        if (top) {
+            if (top->next) {
+                DeleteChunk(top->next);
+            }
+            DeleteChunk(top);
+        }
+        top = nullptr;
+        index = 0;
+        chunks = 0;
+    }
+
+    // Appends the elements of other, bottom first; moves them out if `move` is set.
+    void CopyFrom(const TSegmentedStack& other, bool move = false) {
+        if (other.IsEmpty()) {
+            return;
+        }
+        Chunk* chunk = other.top;
+        while (chunk->prev) {
+            chunk = chunk->prev;
+        }
+        for (;; chunk = chunk->next) {
+            size_t n = chunk == other.top ? other.index : ChunkSize;
+            for (size_t i = 0; i < n; i++) {
+                if (move) {
+                    Push(std::move(*chunk->At(i)));
+                }
+                else {
+                    Push(*chunk->At(i));
+                }
+            }
+            if (chunk == other.top) {
+                break;
+            }
+        }
+    }
+
+    // Takes the chunks of a stack that uses the same memory resource.
+    void MoveFrom(TSegmentedStack& other) {
+        top = other.top;
+        index = other.index;
+        count = other.count;
+        chunks = other.chunks;
+        other.top = nullptr;
+        other.index = 0;
+        other.count = 0;
+        other.chunks = 0;
+    }
+
+public:
+    explicit TSegmentedStack(std::pmr::memory_resource* _resource = nullptr) :
+        top(nullptr), index(0), count(0), chunks(0), resource(_resource) {}
+
+    // Copies use the global heap, like copies of std::pmr containers use the
+    // default resource; moves keep the resource of the source.
+    TSegmentedStack(const TSegmentedStack& other) : TSegmentedStack() {
+        CopyFrom(other);
+    }
+
+    TSegmentedStack(TSegmentedStack&& other) noexcept : TSegmentedStack(other.resource) {
+        MoveFrom(other);
+    }
+
+    TSegmentedStack& operator=(const TSegmentedStack& other) {
+        if (this != &other) {
+            clear();
+            CopyFrom(other);
+        }
+        return *this;
+    }
+
+    // Stacks on different resources cannot exchange chunks, so the elements are moved one by one.
+    TSegmentedStack& operator=(TSegmentedStack&& other) {
+        if (this != &other) {
+            Free();
+            if (resource == other.resource) {
+                MoveFrom(other);
+            }
+            else {
+                CopyFrom(other, true);
+                other.Free();
+            }
+        }
+        return *this;
+    }
+
+    std::pmr::memory_resource* GetResource() const {
+        return resource;
+    }
+
+    ~TSegmentedStack() {
+        Free();
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Elements that fit in the chunks currently held, the spare included.
+    size_t capacity() const {
+        return chunks * ChunkSize;
+    }
+
+    bool IsEmpty() const {
+        return count == 0;
+    }
+
+    void clear() {
+        while (count > 0) {
+            DestroyTop();
+        }
+    }
+
+    T Pop() {
+        if (IsEmpty()) {
+            throw std::underflow_error("Stack is empty");
+        }
+        return PopUnchecked();
+    }
+
+    // For loops whose stack use was validated up front: the stack must not be empty.
+    T PopUnchecked() {
+        T value(std::move(*top->At(index - 1)));
+        DestroyTop();
+        return value;
+    }
+
+    void Push(const T& val) {
+        Emplace(val);
+    }
+
+    void Push(T&& val) {
+        Emplace(std::move(val));
+    }
+
+    template<typename... Args>
+    T& Emplace(Args&&... args) {
+        if (!top || index == ChunkSize) {
+            return EmplaceAdvance(std::forward<Args>(args)...);
+        }
+        T* slot = new (top->At(index)) T(std::forward<Args>(args)...);
+        index++;
+        count++;
+        CALC_HIGH_WATER(STACK_HIGH_WATER, count);
+        return *slot;
+    }
+
+    T& Top() {
+        if (IsEmpty()) {
+            throw std::underflow_error("Stack is empty");
+        }
+        return *top->At(index - 1);
+    }
+
+    const T& Top() const {
+        if (IsEmpty()) {
+            throw std::underflow_error("Stack is empty");
+        }
+        return *top->At(index - 1);
+    }
+
+    T& TopUnchecked() {
+        return *top->At(index - 1);
+    }
+
+    const T& TopUnchecked() const {
+        return *top->At(index - 1);
+    }
+};
+
+#endif
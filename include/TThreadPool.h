@@ -0,0 +1,69 @@
+#ifndef TTHREADPOOL_H
+#define TTHREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Fixed set of worker threads with one task deque per worker. A worker splits
+// the range it runs in halves, keeps pushing the upper half onto its own deque
+// and works on the lower one; idle workers steal the oldest (largest) pending
+// range from the other deques.
+class TThreadPool
+{
+    struct Job;
+
+    struct Task {
+        size_t begin;
+        size_t end;
+        Job* job;
+    };
+
+    struct Worker {
+        mutex lock;
+        deque<Task> tasks;
+        thread handle;
+    };
+
+    vector<unique_ptr<Worker>> workers;
+    atomic<size_t> queued;
+    atomic<bool> stopping;
+    mutex sleepLock;
+    condition_variable wake;
+
+    void Run(size_t self);
+    bool PopLocal(size_t self, Task& task);
+    bool Steal(size_t self, Task& task);
+    void Push(size_t self, const Task& task);
+    void Execute(size_t self, Task task);
+
+public:
+    // threads == 0 uses hardware_concurrency(). When cpus is not empty, worker i
+    // is pinned to cpus[i % cpus.size()] (Linux only, ignored elsewhere).
+    explicit TThreadPool(size_t threads = 0, const vector<int>& cpus = vector<int>());
+    ~TThreadPool();
+
+    TThreadPool(const TThreadPool&) = delete;
+    TThreadPool& operator=(const TThreadPool&) = delete;
+
+    size_t Size() const
+    {
+        return workers.size();
+    }
+
+    // Runs body(first, last) over subranges of [begin, end) no longer than grain
+    // and blocks until all of them are done. The first exception thrown by body
+    // is rethrown here. Must not be called from inside a body.
+    void ParallelFor(size_t begin, size_t end, size_t grain, const function<void(size_t, size_t)>& body);
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef TWORKSTEALINGDEQUE_H
+#define TWORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Chase-Lev work-stealing deque. One owner thread uses the bottom end like a
+// TDynamicStack (Push, Pop, TryPop); any number of other threads take the
+// oldest element from the top end with TrySteal. The circular buffer doubles
+// when full; replaced buffers stay allocated until the deque is destroyed,
+// since a thief may still be reading from one.
+//
+// Memory ordering follows Le, Pop, Cohen and Zappa Nardelli, "Correct and
+// Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013). Elements are
+// stored in atomics, so T must be trivially copyable; pointer-sized T keeps
+// them lock-free.
+template<typename T>
+class TWorkStealingDeque {
+private:
+    static_assert(std::is_trivially_copyable<T>::value, "Elements are copied through std::atomic");
+
+    struct Buffer {
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> items;
+
+        explicit Buffer(size_t capacity) : mask(capacity - 1), items(new std::atomic<T>[capacity]) {}
+
+        size_t Capacity() const {
+            return mask + 1;
+        }
+
+        T Get(int64_t i) const {
+            return items[static_cast<size_t>(i) & mask].load(std::memory_order_relaxed);
+        }
+
+        void Put(int64_t i, const T& value) {
+            items[static_cast<size_t>(i) & mask].store(value, std::memory_order_relaxed);
+        }
+    };
+
+    // Thieves write top and the owner writes bottom; separate cache lines keep
+    // the owner's fast path free of false sharing.
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<Buffer*> buffer;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+    Buffer* Grow(Buffer* old, int64_t b, int64_t t) {
+        buffers.push_back(std::unique_ptr<Buffer>(new Buffer(old->Capacity() * 2)));
+        Buffer* grown = buffers.back().get();
+        for (int64_t i = t; i < b; i++) {
+            grown->Put(i, old->Get(i));
+        }
+        buffer.store(grown, std::memory_order_release);
+        return grown;
+    }
+
+public:
+    // capacity is rounded up to a power of two.
+    explicit TWorkStealingDeque(size_t capacity = 64) : top(0), bottom(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        buffers.push_back(std::unique_ptr<Buffer>(new Buffer(size)));
+        buffer.store(buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    TWorkStealingDeque(const TWorkStealingDeque&) = delete;
+    TWorkStealingDeque& operator=(const TWorkStealingDeque&) = delete;
+
+    // Approximate when other threads are stealing.
+    size_t size() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+    bool IsEmpty() const {
+        return size() == 0;
+    }
+
+    // Owner only.
+    void Push(const T& value) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Buffer* a = buffer.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(a->Capacity()) - 1) {
+            a = Grow(a, b, t);
+        }
+        a->Put(b, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only: takes the most recently pushed element. Returns false if
+    // the deque was empty or a thief took the last element first.
+    bool TryPop(T& out) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* a = buffer.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        out = a->Get(b);
+        if (t == b) {
+            // Last element: race the thieves for it.
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Owner only.
+    T Pop() {
+        T value;
+        if (!TryPop(value)) {
+            throw std::underflow_error("Deque is empty");
+        }
+        return value;
+    }
+
+    // Any thread: takes the oldest element. Returns false if the deque was
+    // empty or another thread took that element first.
+    bool TrySteal(T& out) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+
+        Buffer* a = buffer.load(std::memory_order_acquire);
+        T value = a->Get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+};
+
+#endif
@@ -1,106 +1,186 @@
 #include "TArithmeticExpression.h"
-#include "TDynamicStack.h"
+#include "TExpressionOptimizer.h"
+#include "TInstrumentation.h"
 #include <cctype>
 #include <stdexcept>
 #include <iostream>
-#include <sstream>
-#include <cmath>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 
 using namespace std;
 
-TArithmeticExpression::TArithmeticExpression(string infx)
-    : infix(infx) {
-    priority = { {'+', 1}, {'-', 1}, {'*', 2}, {'/', 2} };
-    Parse();
-    ToPostfix();
+namespace {
+
+struct OperatorInfo {
+    char symbol;
+    int priority;
+    Instruction::OpCode op;
+};
+
+const OperatorInfo kOperators[] = {
+    { '+', 1, Instruction::ADD },
+    { '-', 1, Instruction::SUB },
+    { '*', 2, Instruction::MUL },
+    { '/', 2, Instruction::DIV },
+};
+
+const OperatorInfo* FindOperator(char c) {
+    for (const OperatorInfo& info : kOperators) {
+        if (info.symbol == c) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+int Priority(const Token& token) {
+    return FindOperator(token.value[0])->priority;
+}
+
+}
+
+TArithmeticExpression::TArithmeticExpression(string infx, pmr::memory_resource* arena)
+    : infix(infx, arena ? arena : pmr::get_default_resource()),
+      postfix(infix.get_allocator()), operandNames(infix.get_allocator()), code(infix.get_allocator()),
+      context(infix.get_allocator().resource()), optimizedPostfix(infix.get_allocator()),
+      eliminatedOperations(0), deduplicatedNodes(0) {
+    CALC_COUNT(EXPRESSIONS, 1);
+    pmr::vector<Token> lexems(infix.get_allocator());
+    Parse(lexems);
+    ToPostfix(lexems);
+    Compile();
 }
 
-void TArithmeticExpression::Parse() {
-    lexems.clear();
+void TArithmeticExpression::Parse(pmr::vector<Token>& lexems) {
+    CALC_PHASE(PARSE);
+    // Every token takes at least one character.
+    lexems.reserve(infix.length());
+    operandNames.clear();
+    bool seen[128] = {};
+    size_t seenCount = 0;
 
-    for (size_t i = 0; i < infix.length(); i++) {
-        char c = infix[i];
+    const string_view text(infix);
+    for (size_t i = 0; i < text.length(); i++) {
+        char c = text[i];
         if (isspace(static_cast<unsigned char>(c))) {
             continue;
         }
 
         if (isalpha(static_cast<unsigned char>(c))) {
-            string identifier;
-            while (i < infix.length() && isalpha(static_cast<unsigned char>(infix[i]))) {
-                identifier += infix[i];
+            size_t first = i;
+            while (i < text.length() && isalpha(static_cast<unsigned char>(text[i]))) {
                 i++;
             }
-            i--; 
+            string_view identifier = text.substr(first, i - first);
+            i--;
 
             if (identifier == "sin") {
-                lexems.push_back(Token(Token::FUNCTION_SIN, "sin"));
+                lexems.push_back(Token(Token::FUNCTION_SIN, identifier));
             }
             else if (identifier == "cos") {
-                lexems.push_back(Token(Token::FUNCTION_COS, "cos"));
+                lexems.push_back(Token(Token::FUNCTION_COS, identifier));
             }
             else if (identifier == "pi") {
-                Token piToken(Token::NUMBER, "pi");
-                piToken.numValue = 3.14159265358979323846;
-                lexems.push_back(piToken);
+                lexems.push_back(Token(Token::NUMBER, identifier, 3.14159265358979323846));
             }
-            else if (identifier.length() == 1) {
+            else if (identifier.length() == 1 && static_cast<unsigned char>(c) < 128) {
                 lexems.push_back(Token(Token::OPERAND, identifier));
-                operands[identifier] = 0.0;
+                if (!seen[static_cast<unsigned char>(c)]) {
+                    seen[static_cast<unsigned char>(c)] = true;
+                    seenCount++;
+                }
             }
             else {
-                throw invalid_argument("Unknown function or variable: " + identifier);
+                throw invalid_argument("Unknown function or variable: " + string(identifier));
             }
         }
         else if (isdigit(static_cast<unsigned char>(c)) || c == '.') {
-            string number;
-            bool hasDecimal = (c == '.');
+            size_t first = i;
+            bool hasDecimal = false;
 
-            while (i < infix.length() &&
-                (isdigit(static_cast<unsigned char>(infix[i])) || infix[i] == '.')) {
-                if (infix[i] == '.') {
+            while (i < text.length() &&
+                (isdigit(static_cast<unsigned char>(text[i])) || text[i] == '.')) {
+                if (text[i] == '.') {
                     if (hasDecimal) {
                         throw invalid_argument("Invalid number: multiple decimal points");
                     }
                     hasDecimal = true;
                 }
-                number += infix[i];
                 i++;
             }
+            // An exponent needs at least one digit after the optional sign;
+            // otherwise the 'e' is left for the identifier rule to reject.
+            if (i < text.length() && (text[i] == 'e' || text[i] == 'E')) {
+                size_t digits = i + 1;
+                if (digits < text.length() && (text[digits] == '+' || text[digits] == '-')) {
+                    digits++;
+                }
+                if (digits < text.length() && isdigit(static_cast<unsigned char>(text[digits]))) {
+                    i = digits;
+                    while (i < text.length() && isdigit(static_cast<unsigned char>(text[i]))) {
+                        i++;
+                    }
+                }
+            }
+            string_view number = text.substr(first, i - first);
             i--;
 
-            Token numToken(Token::NUMBER, number);
-            try {
-                numToken.numValue = std::stod(number);
-            }
-            catch (...) {
-                throw invalid_argument("Invalid number format: " + number);
+            // from_chars reads straight from the input, rounds correctly and
+            // ignores the global locale.
+            double value = 0;
+            from_chars_result parsed = from_chars(number.data(), number.data() + number.length(), value);
+            if (parsed.ec != errc() || parsed.ptr != number.data() + number.length()) {
+                throw invalid_argument("Invalid number format: " + string(number));
             }
-            lexems.push_back(numToken);
+            lexems.push_back(Token(Token::NUMBER, number, value));
         }
         else if (c == '(') {
-            lexems.push_back(Token(Token::LEFT_PAREN, "("));
+            lexems.push_back(Token(Token::LEFT_PAREN, text.substr(i, 1)));
         }
         else if (c == ')') {
-            lexems.push_back(Token(Token::RIGHT_PAREN, ")"));
+            lexems.push_back(Token(Token::RIGHT_PAREN, text.substr(i, 1)));
         }
-        else if (c == '+' || c == '-' || c == '*' || c == '/') {
-            lexems.push_back(Token(Token::OPERATOR, string(1, c)));
+        else if (FindOperator(c)) {
+            lexems.push_back(Token(Token::OPERATOR, text.substr(i, 1)));
         }
         else {
             throw invalid_argument("Invalid character in expression: " + string(1, c));
         }
     }
+
+    CALC_COUNT(TOKENS, lexems.size());
+
+    // Names are single ASCII letters, so walking the table gives them sorted.
+    operandNames.reserve(seenCount);
+    for (int ch = 0; ch < 128; ch++) {
+        if (seen[ch]) {
+            operandNames.emplace_back(1, static_cast<char>(ch));
+        }
+    }
 }
 
-void TArithmeticExpression::ToPostfix() {
-    TDynamicStack<Token> st(100);
-    postfix = "";
+void TArithmeticExpression::ToPostfix(const pmr::vector<Token>& lexems) {
+    CALC_PHASE(TO_POSTFIX);
+    // The stack never holds more than every token, so it is allocated once,
+    // whatever the nesting depth; the postfix string gets its exact length.
+    TDynamicStack<Token> st(lexems.size() + 1, infix.get_allocator().resource());
+    size_t length = 0;
+    for (const Token& token : lexems) {
+        if (token.type != Token::LEFT_PAREN && token.type != Token::RIGHT_PAREN) {
+            length += token.value.length() + 1;
+        }
+    }
+    postfix.clear();
+    postfix.reserve(length);
+    code.clear();
+    code.reserve(lexems.size());
 
     for (const Token& token : lexems) {
         switch (token.type) {
         case Token::OPERAND:
         case Token::NUMBER:
-            postfix += token.value + " ";
+            Emit(token);
             break;
 
         case Token::LEFT_PAREN:
@@ -108,18 +188,18 @@ void TArithmeticExpression::ToPostfix() {
             break;
 
         case Token::RIGHT_PAREN: {
-            while (!st.IsEmpty() && st.Top().type != Token::LEFT_PAREN) {
-                postfix += st.Pop().value + " ";
+            while (!st.IsEmpty() && st.TopUnchecked().type != Token::LEFT_PAREN) {
+                Emit(st.PopUnchecked());
             }
             if (st.IsEmpty()) {
                 throw runtime_error("Mismatched parentheses");
             }
-            st.Pop();
+            st.PopUnchecked();
 
             if (!st.IsEmpty() &&
-                (st.Top().type == Token::FUNCTION_SIN ||
-                    st.Top().type == Token::FUNCTION_COS)) {
-                postfix += st.Pop().value + " ";
+                (st.TopUnchecked().type == Token::FUNCTION_SIN ||
+                    st.TopUnchecked().type == Token::FUNCTION_COS)) {
+                Emit(st.PopUnchecked());
             }
             break;
         }
@@ -131,9 +211,9 @@ void TArithmeticExpression::ToPostfix() {
 
         case Token::OPERATOR:
             while (!st.IsEmpty() &&
-                st.Top().type == Token::OPERATOR &&
-                priority[token.value[0]] <= priority[st.Top().value[0]]) {
-                postfix += st.Pop().value + " ";
+                st.TopUnchecked().type == Token::OPERATOR &&
+                Priority(token) <= Priority(st.TopUnchecked())) {
+                Emit(st.PopUnchecked());
             }
             st.Push(token);
             break;
@@ -141,10 +221,10 @@ void TArithmeticExpression::ToPostfix() {
     }
 
     while (!st.IsEmpty()) {
-        if (st.Top().type == Token::LEFT_PAREN) {
+        if (st.TopUnchecked().type == Token::LEFT_PAREN) {
             throw runtime_error("Mismatched parentheses");
         }
-        postfix += st.Pop().value + " ";
+        Emit(st.PopUnchecked());
     }
 
     if (!postfix.empty() && postfix.back() == ' ') {
@@ -152,97 +232,174 @@ void TArithmeticExpression::ToPostfix() {
     }
 }
 
-vector<string> TArithmeticExpression::GetOperands() const {
-    vector<string> op;
-    for (const auto& item : operands) {
-        op.push_back(item.first);
+void TArithmeticExpression::Emit(const Token& token) {
+    postfix.append(token.value.data(), token.value.length());
+    postfix += ' ';
+
+    switch (token.type) {
+    case Token::NUMBER:
+        code.push_back(Instruction(Instruction::PUSH_NUMBER, 0, token.numValue));
+        break;
+    case Token::OPERAND: {
+        auto it = lower_bound(operandNames.begin(), operandNames.end(), token.value);
+        code.push_back(Instruction(Instruction::PUSH_OPERAND, it - operandNames.begin()));
+        break;
+    }
+    case Token::FUNCTION_SIN:
+        code.push_back(Instruction(Instruction::SIN));
+        break;
+    case Token::FUNCTION_COS:
+        code.push_back(Instruction(Instruction::COS));
+        break;
+    case Token::OPERATOR:
+        code.push_back(Instruction(FindOperator(token.value[0])->op));
+        break;
+    default:
+        break;
     }
-    return op;
 }
 
-double TArithmeticExpression::Calculate(const map<string, double>& values) {
-    for (const auto& val : values) {
-        operands[val.first] = val.second;
+namespace {
+
+size_t CountOperations(const pmr::vector<Instruction>& program) {
+    size_t n = 0;
+    for (const Instruction& ins : program) {
+        if (ins.op != Instruction::PUSH_NUMBER && ins.op != Instruction::PUSH_OPERAND &&
+            ins.op != Instruction::STORE_TEMP && ins.op != Instruction::LOAD_TEMP) {
+            n++;
+        }
     }
+    return n;
+}
 
-    return Calculate();
+// Writes the postfix spelling of one instruction to buf (at least 32 bytes)
+// and returns its length.
+size_t FormatInstruction(char* buf, const Instruction& ins, const pmr::vector<pmr::string>& names) {
+    const char* text = nullptr;
+    switch (ins.op) {
+    case Instruction::PUSH_NUMBER:
+        return to_chars(buf, buf + 32, ins.value).ptr - buf;
+    case Instruction::PUSH_OPERAND:
+        return names[ins.slot].copy(buf, 31);
+    case Instruction::STORE_TEMP:
+        buf[0] = '=';
+        buf[1] = 't';
+        return to_chars(buf + 2, buf + 32, ins.slot).ptr - buf;
+    case Instruction::LOAD_TEMP:
+        buf[0] = 't';
+        return to_chars(buf + 1, buf + 32, ins.slot).ptr - buf;
+    case Instruction::ADD: text = "+"; break;
+    case Instruction::SUB: text = "-"; break;
+    case Instruction::MUL: text = "*"; break;
+    case Instruction::DIV: text = "/"; break;
+    case Instruction::SIN: text = "sin"; break;
+    case Instruction::COS: text = "cos"; break;
+    }
+    size_t length = strlen(text);
+    memcpy(buf, text, length);
+    return length;
 }
 
-double TArithmeticExpression::Calculate() {
-    TDynamicStack<double> st(100);
+}
 
-    istringstream iss(postfix);
-    string token;
+// Builds the shared program from the emitted instructions. Well-formed programs
+// are replaced by their optimized form; the postfix string keeps the source form.
+// Malformed programs are still constructible, the error is reported on evaluation.
+void TArithmeticExpression::Compile() {
+    CALC_PHASE(COMPILE);
+    pmr::memory_resource* resource = infix.get_allocator().resource();
+    pmr::polymorphic_allocator<TCompiledProgram> alloc(resource);
 
-    while (iss >> token) {
-        if (token == "+" || token == "-" || token == "*" || token == "/") {
-            if (st.size() < 2) {
-                throw runtime_error("Invalid expression: not enough operands");
-            }
+    program = allocate_shared<TCompiledProgram>(alloc, move(code), operandNames, resource);
+    code.clear();
+    code.shrink_to_fit();
+    eliminatedOperations = 0;
+    deduplicatedNodes = 0;
 
-            double right = st.Pop();
-            double left = st.Pop();
+    if (program->GetError().empty()) {
+        const pmr::vector<Instruction>& source = program->GetCode();
+        TExpressionOptimizer optimizer(source, resource);
+        pmr::vector<Instruction> optimized = optimizer.GetProgram();
+        deduplicatedNodes = optimizer.GetDeduplicatedNodes();
+        eliminatedOperations = CountOperations(source) - CountOperations(optimized);
+        program = allocate_shared<TCompiledProgram>(alloc, move(optimized), operandNames, resource);
 
-            if (token == "+") {
-                st.Push(left + right);
-            }
-            else if (token == "-") {
-                st.Push(left - right);
-            }
-            else if (token == "*") {
-                st.Push(left * right);
-            }
-            else if (token == "/") {
-                if (right == 0.0) {
-                    throw runtime_error("Division by zero");
-                }
-                st.Push(left / right);
-            }
+        // Sized in a first pass, so the string is allocated once.
+        const pmr::vector<Instruction>& evaluated = program->GetCode();
+        char buf[32];
+        size_t length = 0;
+        for (const Instruction& ins : evaluated) {
+            length += FormatInstruction(buf, ins, operandNames) + 1;
         }
-        else if (token == "sin") {
-            if (st.IsEmpty()) {
-                throw runtime_error("Invalid expression: no argument for sin");
-            }
-            double arg = st.Pop();
-            st.Push(sin(arg));
+        optimizedPostfix.clear();
+        optimizedPostfix.reserve(length);
+        for (const Instruction& ins : evaluated) {
+            optimizedPostfix.append(buf, FormatInstruction(buf, ins, operandNames));
+            optimizedPostfix += ' ';
         }
-        else if (token == "cos") {
-            if (st.IsEmpty()) {
-                throw runtime_error("Invalid expression: no argument for cos");
-            }
-            double arg = st.Pop();
-            st.Push(cos(arg));
-        }
-        else if (isdigit(token[0]) || (token[0] == '.' && token.length() > 1) ||
-            (token[0] == '-' && token.length() > 1 && isdigit(token[1]))) {
-            try {
-                double num = stod(token);
-                st.Push(num);
-            }
-            catch (...) {
-                throw runtime_error("Invalid number format: " + token);
-            }
-        }
-        else if (token == "pi") {
-            st.Push(3.14159265358979323846);
-        }
-        else if (token.length() == 1 && isalpha(token[0])) {
-            auto it = operands.find(token);
-            if (it != operands.end()) {
-                st.Push(it->second);
-            }
-            else {
-                throw runtime_error("Undefined variable: " + token);
-            }
-        }
-        else {
-            throw runtime_error("Invalid token in expression: " + token);
+        optimizedPostfix.pop_back();
+    }
+    else {
+        optimizedPostfix = postfix;
+    }
+
+    context.Reserve(*program);
+}
+
+vector<string> TArithmeticExpression::GetOperands() const {
+    const pmr::vector<pmr::string>& names = program->GetOperands();
+    return vector<string>(names.begin(), names.end());
+}
+
+size_t TArithmeticExpression::GetMemoryUsage() const {
+    size_t bytes = sizeof(*this) + infix.capacity() + postfix.capacity() + optimizedPostfix.capacity();
+    bytes += operandNames.capacity() * sizeof(string);
+    bytes += sizeof(TCompiledProgram) + program->GetCode().capacity() * sizeof(Instruction);
+    bytes += program->GetOperands().capacity() * sizeof(string);
+    bytes += context.GetValues().capacity() * sizeof(double);
+    return bytes;
+}
+
+int TArithmeticExpression::GetOperandIndex(const string& name) const {
+    return program->GetOperandIndex(name);
+}
+
+double TArithmeticExpression::Calculate(const map<string, double>& values) {
+    for (const auto& val : values) {
+        int slot = GetOperandIndex(val.first);
+        if (slot >= 0) {
+            context.SetValue(slot, val.second);
         }
     }
 
-    if (st.size() != 1) {
-        throw runtime_error("Invalid expression");
+    return Calculate();
+}
+
+double TArithmeticExpression::Calculate() {
+    return program->Evaluate(context);
+}
+
+double TArithmeticExpression::Calculate(const vector<double>& values) const {
+    if (values.size() < program->GetOperands().size()) {
+        throw invalid_argument("Not enough variable values");
     }
+    return Calculate(values.data());
+}
+
+double TArithmeticExpression::Calculate(const double* values) const {
+    thread_local TEvaluationContext ctx;
+    return program->Evaluate(values, ctx);
+}
 
-    return st.Pop();
-}
\ No newline at end of file
+double TArithmeticExpression::Calculate(TEvaluationContext& ctx) const {
+    return program->Evaluate(ctx);
+}
+
+void TArithmeticExpression::CalculateBatch(const double* const* columns, double* out, size_t rows) const {
+    thread_local TEvaluationContext ctx;
+    program->EvaluateBatch(columns, out, rows, ctx);
+}
+
+void TArithmeticExpression::CalculateBatch(const double* const* columns, double* out, size_t rows, TThreadPool& pool) const {
+    program->EvaluateBatch(columns, out, rows, pool);
+}
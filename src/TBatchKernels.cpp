@@ -0,0 +1,83 @@
+#include "TBatchKernels.h"
+#include <cmath>
+
+#if CALC_X86_KERNELS
+#include "TBatchKernelsImpl.h"
+#endif
+
+using namespace std;
+
+namespace {
+
+void ScalarAdd(double* dst, const double* a, const double* b, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = a[i] + b[i];
+}
+
+void ScalarSub(double* dst, const double* a, const double* b, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = a[i] - b[i];
+}
+
+void ScalarMul(double* dst, const double* a, const double* b, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = a[i] * b[i];
+}
+
+bool ScalarDiv(double* dst, const double* a, const double* b, size_t n) {
+    bool zero = false;
+    for (size_t i = 0; i < n; i++) {
+        zero |= (b[i] == 0.0);
+        dst[i] = a[i] / b[i];
+    }
+    return !zero;
+}
+
+void ScalarSin(double* dst, const double* a, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = sin(a[i]);
+}
+
+void ScalarCos(double* dst, const double* a, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = cos(a[i]);
+}
+
+const TBatchKernels kScalarKernels = {
+    TBatchKernels::SCALAR, "scalar",
+    ScalarAdd, ScalarSub, ScalarMul, ScalarDiv, ScalarSin, ScalarCos
+};
+
+}
+
+const TBatchKernels* TBatchKernels::Get(Isa isa) {
+    switch (isa) {
+    case SCALAR:
+        return &kScalarKernels;
+#if CALC_X86_KERNELS
+    case SSE2:
+        return &Sse2BatchKernels();
+    case AVX2:
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return &Avx2BatchKernels();
+        }
+        break;
+    case AVX512:
+        if (__builtin_cpu_supports("avx512f")) {
+            return &Avx512BatchKernels();
+        }
+        break;
+#endif
+    default:
+        break;
+    }
+    return nullptr;
+}
+
+const TBatchKernels& TBatchKernels::Best() {
+    static const TBatchKernels* best = [] {
+        const Isa order[] = { AVX512, AVX2, SSE2 };
+        for (Isa isa : order) {
+            if (const TBatchKernels* k = Get(isa)) {
+                return k;
+            }
+        }
+        return &kScalarKernels;
+    }();
+    return *best;
+}
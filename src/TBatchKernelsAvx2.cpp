@@ -0,0 +1,45 @@
+#include "TBatchKernelsImpl.h"
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2Ops {
+    typedef __m256d Vec;
+    typedef __m256i Int;
+    static const size_t kWidth = 4;
+
+    static Vec Load(const double* p) { return _mm256_loadu_pd(p); }
+    static void Store(double* p, Vec v) { _mm256_storeu_pd(p, v); }
+    static Vec Set(double x) { return _mm256_set1_pd(x); }
+    static Vec Add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    static Vec Div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+    static Vec Madd(Vec a, Vec b, Vec c) { return _mm256_fmadd_pd(a, b, c); }
+
+    static bool AnyZero(Vec v) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(v, _mm256_setzero_pd(), _CMP_EQ_OQ)) != 0;
+    }
+    static bool AnyOutside(Vec v, double limit) {
+        Vec abs = _mm256_andnot_pd(_mm256_set1_pd(-0.0), v);
+        return _mm256_movemask_pd(_mm256_cmp_pd(abs, _mm256_set1_pd(limit), _CMP_NLE_UQ)) != 0;
+    }
+
+    static Int AsInt(Vec v) { return _mm256_castpd_si256(v); }
+    static Vec AsVec(Int i) { return _mm256_castsi256_pd(i); }
+    static Int IntSet(long long x) { return _mm256_set1_epi64x(x); }
+    static Int IntAdd(Int a, Int b) { return _mm256_add_epi64(a, b); }
+    static Int IntSub(Int a, Int b) { return _mm256_sub_epi64(a, b); }
+    static Int IntAnd(Int a, Int b) { return _mm256_and_si256(a, b); }
+    static Int IntAndNot(Int a, Int b) { return _mm256_andnot_si256(a, b); }
+    static Int IntOr(Int a, Int b) { return _mm256_or_si256(a, b); }
+    static Int IntXor(Int a, Int b) { return _mm256_xor_si256(a, b); }
+    static Int IntShiftLeft62(Int a) { return _mm256_slli_epi64(a, 62); }
+};
+
+}
+
+const TBatchKernels& Avx2BatchKernels() {
+    static const TBatchKernels kernels = TVectorKernels<Avx2Ops>::Table(TBatchKernels::AVX2, "avx2");
+    return kernels;
+}
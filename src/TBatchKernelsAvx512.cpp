@@ -0,0 +1,56 @@
+#include "TBatchKernelsImpl.h"
+
+// GCC 12 reports the undefined pass-through operands that avx512fintrin.h
+// gives _mm512_andnot_si512 and _mm512_slli_epi64 as maybe-uninitialized.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#else
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Only AVX-512F is assumed, so bitwise operations go through the integer domain.
+struct Avx512Ops {
+    typedef __m512d Vec;
+    typedef __m512i Int;
+    static const size_t kWidth = 8;
+
+    static Vec Load(const double* p) { return _mm512_loadu_pd(p); }
+    static void Store(double* p, Vec v) { _mm512_storeu_pd(p, v); }
+    static Vec Set(double x) { return _mm512_set1_pd(x); }
+    static Vec Add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+    static Vec Div(Vec a, Vec b) { return _mm512_div_pd(a, b); }
+    static Vec Madd(Vec a, Vec b, Vec c) { return _mm512_fmadd_pd(a, b, c); }
+
+    static bool AnyZero(Vec v) {
+        return _mm512_cmp_pd_mask(v, _mm512_setzero_pd(), _CMP_EQ_OQ) != 0;
+    }
+    static bool AnyOutside(Vec v, double limit) {
+        Vec abs = AsVec(_mm512_andnot_si512(AsInt(_mm512_set1_pd(-0.0)), AsInt(v)));
+        return _mm512_cmp_pd_mask(abs, _mm512_set1_pd(limit), _CMP_NLE_UQ) != 0;
+    }
+
+    static Int AsInt(Vec v) { return _mm512_castpd_si512(v); }
+    static Vec AsVec(Int i) { return _mm512_castsi512_pd(i); }
+    static Int IntSet(long long x) { return _mm512_set1_epi64(x); }
+    static Int IntAdd(Int a, Int b) { return _mm512_add_epi64(a, b); }
+    static Int IntSub(Int a, Int b) { return _mm512_sub_epi64(a, b); }
+    static Int IntAnd(Int a, Int b) { return _mm512_and_si512(a, b); }
+    static Int IntAndNot(Int a, Int b) { return _mm512_andnot_si512(a, b); }
+    static Int IntOr(Int a, Int b) { return _mm512_or_si512(a, b); }
+    static Int IntXor(Int a, Int b) { return _mm512_xor_si512(a, b); }
+    static Int IntShiftLeft62(Int a) { return _mm512_slli_epi64(a, 62); }
+};
+
+}
+
+const TBatchKernels& Avx512BatchKernels() {
+    static const TBatchKernels kernels = TVectorKernels<Avx512Ops>::Table(TBatchKernels::AVX512, "avx512");
+    return kernels;
+}
@@ -0,0 +1,151 @@
+#ifndef TBATCHKERNELSIMPL_H
+#define TBATCHKERNELSIMPL_H
+
+// Vector kernels shared by the per-ISA translation units. Each unit is built
+// with its own -m flags and instantiates TVectorKernels with its own register
+// traits V, so everything here must stay a template over V: a non-template
+// inline function (including standard library helpers) could be emitted with
+// AVX instructions and then picked by the linker for the baseline code.
+
+#include "TBatchKernels.h"
+#include <cmath>
+#include <cstdint>
+
+const TBatchKernels& Sse2BatchKernels();
+const TBatchKernels& Avx2BatchKernels();
+const TBatchKernels& Avx512BatchKernels();
+
+template<typename V>
+struct TVectorKernels {
+    typedef typename V::Vec Vec;
+    typedef typename V::Int Int;
+    static const size_t W = V::kWidth;
+
+    static void Add(double* dst, const double* a, const double* b, size_t n) {
+        size_t i = 0;
+        for (; i + W <= n; i += W) V::Store(dst + i, V::Add(V::Load(a + i), V::Load(b + i)));
+        for (; i < n; i++) dst[i] = a[i] + b[i];
+    }
+
+    static void Sub(double* dst, const double* a, const double* b, size_t n) {
+        size_t i = 0;
+        for (; i + W <= n; i += W) V::Store(dst + i, V::Sub(V::Load(a + i), V::Load(b + i)));
+        for (; i < n; i++) dst[i] = a[i] - b[i];
+    }
+
+    static void Mul(double* dst, const double* a, const double* b, size_t n) {
+        size_t i = 0;
+        for (; i + W <= n; i += W) V::Store(dst + i, V::Mul(V::Load(a + i), V::Load(b + i)));
+        for (; i < n; i++) dst[i] = a[i] * b[i];
+    }
+
+    static bool Div(double* dst, const double* a, const double* b, size_t n) {
+        size_t i = 0;
+        bool zero = false;
+        for (; i + W <= n; i += W) {
+            Vec d = V::Load(b + i);
+            zero |= V::AnyZero(d);
+            V::Store(dst + i, V::Div(V::Load(a + i), d));
+        }
+        for (; i < n; i++) {
+            zero |= (b[i] == 0.0);
+            dst[i] = a[i] / b[i];
+        }
+        return !zero;
+    }
+
+    // sin(x) for quadrantShift 0, cos(x) = sin(x + pi/2) for quadrantShift 1.
+    // Works on |x| and restores the sign for sin, which is odd, so that
+    // sin(-0) stays -0. |x| = n*pi/2 + r with |r| <= pi/4 (four-part Cody-Waite reduction, exact
+    // steps while |n| < 2^20), then the fdlibm kernels on r picked by n mod 4.
+    template<int quadrantShift>
+    static Vec SinCos(Vec x) {
+        const double kTwoOverPi = 6.36619772367581382433e-01;
+        const double kPio2_1 = 1.57079632673412561417e+00;
+        const double kPio2_2 = 6.07710050630396597660e-11;
+        const double kPio2_3 = 2.02226624871116645580e-21;
+        const double kPio2_3t = 8.47842766036889956997e-32;
+        const double kRoundMagic = 6755399441055744.0;  // 1.5 * 2^52
+
+        if (V::AnyOutside(x, TBatchKernels::kSinCosFastLimit)) {
+            double lanes[W];
+            V::Store(lanes, x);
+            for (size_t i = 0; i < W; i++) {
+                lanes[i] = quadrantShift ? std::cos(lanes[i]) : std::sin(lanes[i]);
+            }
+            return V::Load(lanes);
+        }
+
+        Int signOfX = V::IntAnd(V::AsInt(x), V::AsInt(V::Set(-0.0)));
+        x = V::AsVec(V::IntXor(V::AsInt(x), signOfX));
+
+        Vec shifted = V::Add(V::Mul(x, V::Set(kTwoOverPi)), V::Set(kRoundMagic));
+        Vec n = V::Sub(shifted, V::Set(kRoundMagic));
+        // The low mantissa bits of `shifted` hold n in two's complement.
+        Int q = V::IntAdd(V::AsInt(shifted), V::IntSet(quadrantShift));
+
+        Vec r = V::Sub(x, V::Mul(n, V::Set(kPio2_1)));
+        r = V::Sub(r, V::Mul(n, V::Set(kPio2_2)));
+        r = V::Sub(r, V::Mul(n, V::Set(kPio2_3)));
+        r = V::Sub(r, V::Mul(n, V::Set(kPio2_3t)));
+
+        Vec z = V::Mul(r, r);
+
+        // __kernel_sin: r + r^3 * (S1 + z*(S2 + ... + z*S6))
+        Vec ps = V::Madd(z, V::Set(1.58969099521155010221e-10), V::Set(-2.50507602534068634195e-08));
+        ps = V::Madd(z, ps, V::Set(2.75573137070700676789e-06));
+        ps = V::Madd(z, ps, V::Set(-1.98412698298579493134e-04));
+        ps = V::Madd(z, ps, V::Set(8.33333333332248946124e-03));
+        ps = V::Madd(z, ps, V::Set(-1.66666666666666324348e-01));
+        Vec s = V::Madd(V::Mul(z, r), ps, r);
+
+        // __kernel_cos: w + (((1 - w) - z/2) + z^2 * (C1 + ... + z^5*C6)), w = 1 - z/2
+        Vec pc = V::Madd(z, V::Set(-1.13596475577881948265e-11), V::Set(2.08757232129817482790e-09));
+        pc = V::Madd(z, pc, V::Set(-2.75573143513906633035e-07));
+        pc = V::Madd(z, pc, V::Set(2.48015872894767294178e-05));
+        pc = V::Madd(z, pc, V::Set(-1.38888888888741095749e-03));
+        pc = V::Madd(z, pc, V::Set(4.16666666666666019037e-02));
+        Vec hz = V::Mul(z, V::Set(0.5));
+        Vec w = V::Sub(V::Set(1.0), hz);
+        Vec tail = V::Add(V::Sub(V::Sub(V::Set(1.0), w), hz), V::Mul(V::Mul(z, z), pc));
+        Vec c = V::Add(w, tail);
+
+        // Odd quadrants take the cosine kernel, quadrants 2 and 3 flip the sign.
+        Int one = V::IntSet(1);
+        Int useCos = V::IntSub(V::IntSet(0), V::IntAnd(q, one));
+        Int result = V::IntOr(V::IntAnd(useCos, V::AsInt(c)), V::IntAndNot(useCos, V::AsInt(s)));
+        Int sign = V::IntShiftLeft62(V::IntAnd(q, V::IntSet(2)));
+        if (quadrantShift == 0) {
+            sign = V::IntXor(sign, signOfX);
+        }
+        return V::AsVec(V::IntXor(result, sign));
+    }
+
+    template<int quadrantShift>
+    static void SinCosArray(double* dst, const double* a, size_t n) {
+        size_t i = 0;
+        for (; i + W <= n; i += W) V::Store(dst + i, SinCos<quadrantShift>(V::Load(a + i)));
+        if (i < n) {
+            // Pad the tail so every element goes through the same code path.
+            double lanes[W];
+            for (size_t j = 0; j < W; j++) lanes[j] = i + j < n ? a[i + j] : 0.0;
+            V::Store(lanes, SinCos<quadrantShift>(V::Load(lanes)));
+            for (size_t j = 0; i + j < n; j++) dst[i + j] = lanes[j];
+        }
+    }
+
+    static void Sin(double* dst, const double* a, size_t n) {
+        SinCosArray<0>(dst, a, n);
+    }
+
+    static void Cos(double* dst, const double* a, size_t n) {
+        SinCosArray<1>(dst, a, n);
+    }
+
+    static TBatchKernels Table(TBatchKernels::Isa isa, const char* name) {
+        TBatchKernels k = { isa, name, Add, Sub, Mul, Div, Sin, Cos };
+        return k;
+    }
+};
+
+#endif
@@ -0,0 +1,45 @@
+#include "TBatchKernelsImpl.h"
+#include <emmintrin.h>
+
+namespace {
+
+struct Sse2Ops {
+    typedef __m128d Vec;
+    typedef __m128i Int;
+    static const size_t kWidth = 2;
+
+    static Vec Load(const double* p) { return _mm_loadu_pd(p); }
+    static void Store(double* p, Vec v) { _mm_storeu_pd(p, v); }
+    static Vec Set(double x) { return _mm_set1_pd(x); }
+    static Vec Add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+    static Vec Div(Vec a, Vec b) { return _mm_div_pd(a, b); }
+    static Vec Madd(Vec a, Vec b, Vec c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+
+    static bool AnyZero(Vec v) {
+        return _mm_movemask_pd(_mm_cmpeq_pd(v, _mm_setzero_pd())) != 0;
+    }
+    static bool AnyOutside(Vec v, double limit) {
+        Vec abs = _mm_andnot_pd(_mm_set1_pd(-0.0), v);
+        return _mm_movemask_pd(_mm_cmpnle_pd(abs, _mm_set1_pd(limit))) != 0;
+    }
+
+    static Int AsInt(Vec v) { return _mm_castpd_si128(v); }
+    static Vec AsVec(Int i) { return _mm_castsi128_pd(i); }
+    static Int IntSet(long long x) { return _mm_set1_epi64x(x); }
+    static Int IntAdd(Int a, Int b) { return _mm_add_epi64(a, b); }
+    static Int IntSub(Int a, Int b) { return _mm_sub_epi64(a, b); }
+    static Int IntAnd(Int a, Int b) { return _mm_and_si128(a, b); }
+    static Int IntAndNot(Int a, Int b) { return _mm_andnot_si128(a, b); }
+    static Int IntOr(Int a, Int b) { return _mm_or_si128(a, b); }
+    static Int IntXor(Int a, Int b) { return _mm_xor_si128(a, b); }
+    static Int IntShiftLeft62(Int a) { return _mm_slli_epi64(a, 62); }
+};
+
+}
+
+const TBatchKernels& Sse2BatchKernels() {
+    static const TBatchKernels kernels = TVectorKernels<Sse2Ops>::Table(TBatchKernels::SSE2, "sse2");
+    return kernels;
+}
@@ -0,0 +1,172 @@
+#include "TBatchMode.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <exception>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+bool IsSeparator(char c) {
+    return c == ' ' || c == '\t' || c == ',';
+}
+
+bool IsBlank(const string& text, size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+        if (!isspace(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads `name=value` pairs from text[pos, last) into values by operand slot.
+// Names the expression does not use are ignored and variables left unbound
+// keep their 0, as with Calculate(map).
+void Bind(const string& text, size_t pos, size_t last, const TArithmeticExpression& expr,
+    vector<double>& values) {
+    string name;
+    while (true) {
+        while (pos < last && IsSeparator(text[pos])) {
+            pos++;
+        }
+        if (pos == last) {
+            return;
+        }
+
+        size_t first = pos;
+        while (pos < last && (isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_')) {
+            pos++;
+        }
+        name.assign(text, first, pos - first);
+        while (pos < last && (text[pos] == ' ' || text[pos] == '\t')) {
+            pos++;
+        }
+        if (name.empty() || pos == last || text[pos] != '=') {
+            throw invalid_argument("Invalid binding: expected name=value");
+        }
+        pos++;
+        while (pos < last && (text[pos] == ' ' || text[pos] == '\t')) {
+            pos++;
+        }
+
+        first = pos;
+        while (pos < last && !IsSeparator(text[pos])) {
+            pos++;
+        }
+        const char* begin = text.data() + first;
+        const char* end = text.data() + pos;
+        if (end - begin > 1 && begin[0] == '+' && begin[1] != '-') {
+            begin++;
+        }
+        double value = 0;
+        from_chars_result parsed = from_chars(begin, end, value);
+        if (begin == end || parsed.ec != errc() || parsed.ptr != end) {
+            throw invalid_argument("Invalid value for " + name + ": " + text.substr(first, pos - first));
+        }
+
+        int slot = expr.GetOperandIndex(name);
+        if (slot >= 0) {
+            values[slot] = value;
+        }
+    }
+}
+
+}
+
+TBatchMode::TBatchMode(TExpressionCache& cache, TThreadPool& pool, size_t chunkLines)
+    : cache(cache), pool(pool), chunkLines(chunkLines ? chunkLines : 1) {}
+
+bool TBatchMode::EvaluateLine(const string& line, TExpressionCache& cache, string& out) {
+    thread_local string expression;
+    thread_local vector<double> values;
+
+    size_t last = line.size();
+    if (last > 0 && line[last - 1] == '\r') {
+        last--;
+    }
+    size_t semicolon = line.find(';');
+    size_t exprEnd = semicolon < last ? semicolon : last;
+
+    try {
+        if (IsBlank(line, 0, exprEnd)) {
+            if (exprEnd == last) {
+                out += '\n';
+                return true;
+            }
+            throw invalid_argument("Empty expression");
+        }
+
+        expression.assign(line, 0, exprEnd);
+        auto expr = cache.Get(expression);
+
+        size_t operands = expr->GetCompiledProgram()->GetOperands().size();
+        values.assign(operands, 0.0);
+        if (exprEnd < last) {
+            Bind(line, exprEnd + 1, last, *expr, values);
+        }
+
+        double result = expr->Calculate(values.data());
+        char buf[32];
+        out.append(buf, to_chars(buf, buf + sizeof(buf), result).ptr);
+        out += '\n';
+        return true;
+    }
+    catch (const exception& e) {
+        out += "error: ";
+        out += e.what();
+        out += '\n';
+        return false;
+    }
+}
+
+TBatchMode::Stats TBatchMode::Run(istream& in, ostream& out) {
+    Stats stats = { 0, 0 };
+
+    while (true) {
+        size_t count = 0;
+        while (count < chunkLines) {
+            if (count == lines.size()) {
+                lines.emplace_back();
+            }
+            if (!getline(in, lines[count])) {
+                break;
+            }
+            count++;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        size_t blockCount = (count + kBlockLines - 1) / kBlockLines;
+        if (blocks.size() < blockCount) {
+            blocks.resize(blockCount);
+            blockErrors.resize(blockCount);
+        }
+        pool.ParallelFor(0, blockCount, 1, [&](size_t first, size_t last) {
+            for (size_t b = first; b < last; b++) {
+                blocks[b].clear();
+                blockErrors[b] = 0;
+                size_t end = min(count, (b + 1) * kBlockLines);
+                for (size_t i = b * kBlockLines; i < end; i++) {
+                    if (!EvaluateLine(lines[i], cache, blocks[b])) {
+                        blockErrors[b]++;
+                    }
+                }
+            }
+        });
+
+        for (size_t b = 0; b < blockCount; b++) {
+            out.write(blocks[b].data(), blocks[b].size());
+            stats.errors += blockErrors[b];
+        }
+        stats.lines += count;
+        if (count < chunkLines) {
+            break;
+        }
+    }
+    out.flush();
+    return stats;
+}
@@ -0,0 +1,289 @@
+#include "TCompiledProgram.h"
+#include "TBatchKernels.h"
+#include "TInstrumentation.h"
+#include "TThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+TCompiledProgram::TCompiledProgram(pmr::vector<Instruction> instructions, const pmr::vector<pmr::string>& names,
+    pmr::memory_resource* resource)
+    : code(move(instructions), resource), instructions(code.data()), instructionCount(code.size()),
+      operandNames(names, resource), stackDepth(0), tempCount(0) {
+    Validate();
+}
+
+TCompiledProgram::TCompiledProgram(const Instruction* first, size_t count, const pmr::vector<pmr::string>& names,
+    pmr::memory_resource* resource)
+    : code(resource), instructions(first), instructionCount(count),
+      operandNames(names, resource), stackDepth(0), tempCount(0) {
+    Validate();
+}
+
+// Simulates the stack depth of the program once, so that Evaluate() can run
+// without per-instruction checks. Malformed programs are still constructible;
+// every evaluation reports the error instead.
+void TCompiledProgram::Validate() {
+    size_t depth = 0;
+    stackDepth = 0;
+    tempCount = 0;
+    error = "";
+
+    for (const Instruction& ins : Instructions()) {
+        switch (ins.op) {
+        case Instruction::PUSH_NUMBER:
+            depth++;
+            break;
+        case Instruction::PUSH_OPERAND:
+            if (ins.slot >= operandNames.size()) {
+                error = "Invalid expression";
+                return;
+            }
+            depth++;
+            break;
+        case Instruction::SIN:
+        case Instruction::COS:
+            if (depth < 1) {
+                error = ins.op == Instruction::SIN ?
+                    "Invalid expression: no argument for sin" :
+                    "Invalid expression: no argument for cos";
+                return;
+            }
+            break;
+        case Instruction::STORE_TEMP:
+            if (depth < 1 || ins.slot != tempCount) {
+                error = "Invalid expression";
+                return;
+            }
+            tempCount++;
+            break;
+        case Instruction::LOAD_TEMP:
+            if (ins.slot >= tempCount) {
+                error = "Invalid expression";
+                return;
+            }
+            depth++;
+            break;
+        case Instruction::ADD:
+        case Instruction::SUB:
+        case Instruction::MUL:
+        case Instruction::DIV:
+            if (depth < 2) {
+                error = "Invalid expression: not enough operands";
+                return;
+            }
+            depth--;
+            break;
+        default:
+            error = "Invalid expression: unknown instruction";
+            return;
+        }
+        stackDepth = max(stackDepth, depth);
+    }
+
+    if (depth != 1) {
+        error = "Invalid expression";
+    }
+}
+
+TEvaluationContext::TEvaluationContext(const TCompiledProgram& program, pmr::memory_resource* resource)
+    : values(resource), scratch(resource), args(resource), columns(resource) {
+    Reserve(program);
+}
+
+void TEvaluationContext::Reserve(const TCompiledProgram& program) {
+    if (values.size() < program.GetOperands().size()) {
+        values.resize(program.GetOperands().size(), 0.0);
+    }
+    size_t needed = program.GetStackDepth() + program.GetTempCount();
+    if (needed > TCompiledProgram::kLocalScratch && scratch.size() < needed) {
+        scratch.resize(needed);
+    }
+}
+
+int TCompiledProgram::GetOperandIndex(const string& name) const {
+    auto it = lower_bound(operandNames.begin(), operandNames.end(), string_view(name));
+    if (it == operandNames.end() || *it != string_view(name)) {
+        return -1;
+    }
+    return static_cast<int>(it - operandNames.begin());
+}
+
+double TCompiledProgram::Evaluate(TEvaluationContext& ctx) const {
+    if (ctx.values.size() < operandNames.size()) {
+        ctx.values.resize(operandNames.size(), 0.0);
+    }
+    return Evaluate(ctx.values.data(), ctx);
+}
+
+double TCompiledProgram::Evaluate(const double* vars, TEvaluationContext& ctx) const {
+    CALC_PHASE(EVALUATE);
+    if (!error.empty()) {
+        throw runtime_error(error);
+    }
+
+    size_t needed = stackDepth + tempCount;
+    if (needed <= kLocalScratch) {
+        double local[kLocalScratch];
+        return Run(vars, local);
+    }
+    if (ctx.scratch.size() < needed) {
+        ctx.scratch.resize(needed);
+    }
+    return Run(vars, ctx.scratch.data());
+}
+
+// The stack occupies scratch[0, stackDepth), temporaries follow it.
+double TCompiledProgram::Run(const double* vars, double* scratch) const {
+    double* temps = scratch + stackDepth;
+    double* top = scratch - 1;
+
+    for (const Instruction& ins : Instructions()) {
+        switch (ins.op) {
+        case Instruction::PUSH_NUMBER:
+            *++top = ins.value;
+            break;
+        case Instruction::PUSH_OPERAND:
+            *++top = vars[ins.slot];
+            break;
+        case Instruction::ADD:
+            top[-1] += top[0];
+            top--;
+            break;
+        case Instruction::SUB:
+            top[-1] -= top[0];
+            top--;
+            break;
+        case Instruction::MUL:
+            top[-1] *= top[0];
+            top--;
+            break;
+        case Instruction::DIV:
+            if (top[0] == 0.0) {
+                throw runtime_error("Division by zero");
+            }
+            top[-1] /= top[0];
+            top--;
+            break;
+        case Instruction::SIN:
+            top[0] = sin(top[0]);
+            break;
+        case Instruction::COS:
+            top[0] = cos(top[0]);
+            break;
+        case Instruction::STORE_TEMP:
+            temps[ins.slot] = top[0];
+            break;
+        case Instruction::LOAD_TEMP:
+            *++top = temps[ins.slot];
+            break;
+        }
+    }
+
+    return *top;
+}
+
+namespace {
+
+const size_t kBatchBlock = 256;
+const size_t kParallelGrain = 64 * kBatchBlock;
+
+}
+
+void TCompiledProgram::EvaluateBatch(const double* const* columns, double* out, size_t rows, TEvaluationContext& ctx) const {
+    CALC_PHASE(EVALUATE_BATCH);
+    CALC_COUNT(BATCH_ROWS, rows);
+    if (!error.empty()) {
+        throw runtime_error(error);
+    }
+
+    // Stack slot i owns scratch[i*kBatchBlock ...]; args[i] points either there
+    // or straight into an input column, so variables are never copied.
+    // Temporaries follow the stack slots.
+    const TBatchKernels& kernels = TBatchKernels::Best();
+
+    pmr::vector<double>& scratch = ctx.scratch;
+    pmr::vector<const double*>& args = ctx.args;
+    if (scratch.size() < (stackDepth + tempCount) * kBatchBlock) {
+        scratch.resize((stackDepth + tempCount) * kBatchBlock);
+    }
+    if (args.size() < stackDepth) {
+        args.resize(stackDepth);
+    }
+    double* temps = scratch.data() + stackDepth * kBatchBlock;
+
+    for (size_t first = 0; first < rows; first += kBatchBlock) {
+        size_t n = min(kBatchBlock, rows - first);
+        size_t depth = 0;
+
+        for (const Instruction& ins : Instructions()) {
+            double* dst;
+            switch (ins.op) {
+            case Instruction::PUSH_NUMBER:
+                dst = scratch.data() + depth * kBatchBlock;
+                fill(dst, dst + n, ins.value);
+                args[depth++] = dst;
+                break;
+            case Instruction::PUSH_OPERAND:
+                args[depth++] = columns[ins.slot] + first;
+                break;
+            case Instruction::SIN:
+            case Instruction::COS:
+                dst = scratch.data() + (depth - 1) * kBatchBlock;
+                if (ins.op == Instruction::SIN) {
+                    kernels.sin(dst, args[depth - 1], n);
+                }
+                else {
+                    kernels.cos(dst, args[depth - 1], n);
+                }
+                args[depth - 1] = dst;
+                break;
+            case Instruction::STORE_TEMP:
+                dst = temps + ins.slot * kBatchBlock;
+                copy(args[depth - 1], args[depth - 1] + n, dst);
+                break;
+            case Instruction::LOAD_TEMP:
+                args[depth++] = temps + ins.slot * kBatchBlock;
+                break;
+            default:
+                depth--;
+                dst = scratch.data() + (depth - 1) * kBatchBlock;
+                switch (ins.op) {
+                case Instruction::ADD: kernels.add(dst, args[depth - 1], args[depth], n); break;
+                case Instruction::SUB: kernels.sub(dst, args[depth - 1], args[depth], n); break;
+                case Instruction::MUL: kernels.mul(dst, args[depth - 1], args[depth], n); break;
+                default:
+                    if (!kernels.div(dst, args[depth - 1], args[depth], n)) {
+                        throw runtime_error("Division by zero");
+                    }
+                    break;
+                }
+                args[depth - 1] = dst;
+                break;
+            }
+        }
+
+        copy(args[0], args[0] + n, out + first);
+    }
+}
+
+void TCompiledProgram::EvaluateBatch(const double* const* columns, double* out, size_t rows, TThreadPool& pool) const {
+    if (!error.empty()) {
+        throw runtime_error(error);
+    }
+
+    size_t vars = operandNames.size();
+    pool.ParallelFor(0, rows, kParallelGrain, [&](size_t first, size_t last) {
+        thread_local TEvaluationContext ctx;
+        pmr::vector<const double*>& cols = ctx.columns;
+        if (cols.size() < vars) {
+            cols.resize(vars);
+        }
+        for (size_t v = 0; v < vars; v++) {
+            cols[v] = columns[v] + first;
+        }
+        EvaluateBatch(cols.data(), out + first, last - first, ctx);
+    });
+}
@@ -0,0 +1,308 @@
+#include "TDataset.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const char kMagic[8] = { 'C', 'A', 'L', 'C', 'C', 'O', 'L', 'S' };
+const uint32_t kVersion = 1;
+const size_t kFixedHeader = 24;
+
+size_t AlignUp(size_t offset) {
+    return (offset + 7) & ~size_t(7);
+}
+
+bool IsBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+size_t ColumnarHeaderSize(const vector<string>& names) {
+    size_t size = kFixedHeader;
+    for (const string& name : names) {
+        size += sizeof(uint32_t) + name.size();
+    }
+    return AlignUp(size);
+}
+
+// Creates a columnar file for `rows` rows of `names` and points columns[i]
+// at the mapped storage of column i.
+TMappedFile CreateColumnar(const string& path, const vector<string>& names, size_t rows, vector<double*>& columns) {
+    size_t header = ColumnarHeaderSize(names);
+    TMappedFile file(path, header + names.size() * rows * sizeof(double));
+    char* p = file.Data();
+
+    uint32_t count = static_cast<uint32_t>(names.size());
+    uint64_t rowCount = rows;
+    memcpy(p, kMagic, sizeof(kMagic));
+    memcpy(p + 8, &kVersion, sizeof(kVersion));
+    memcpy(p + 12, &count, sizeof(count));
+    memcpy(p + 16, &rowCount, sizeof(rowCount));
+    size_t pos = kFixedHeader;
+    for (const string& name : names) {
+        uint32_t length = static_cast<uint32_t>(name.size());
+        memcpy(p + pos, &length, sizeof(length));
+        memcpy(p + pos + sizeof(length), name.data(), name.size());
+        pos += sizeof(length) + name.size();
+    }
+    memset(p + pos, 0, header - pos);
+
+    columns.resize(names.size());
+    for (size_t c = 0; c < names.size(); c++) {
+        columns[c] = reinterpret_cast<double*>(p + header) + c * rows;
+    }
+    return file;
+}
+
+}
+
+TDataset::TDataset(const string& path) : file(path), columnar(false), rows(0), dataOffset(0) {
+    if (file.Size() >= sizeof(kMagic) && memcmp(file.Data(), kMagic, sizeof(kMagic)) == 0) {
+        columnar = true;
+        OpenColumnar();
+    }
+    else {
+        OpenCsv();
+    }
+}
+
+void TDataset::OpenColumnar() {
+    const char* p = file.Data();
+    size_t size = file.Size();
+    if (size < kFixedHeader) {
+        throw runtime_error("Truncated columnar header");
+    }
+
+    uint32_t version, count;
+    uint64_t rowCount;
+    memcpy(&version, p + 8, sizeof(version));
+    memcpy(&count, p + 12, sizeof(count));
+    memcpy(&rowCount, p + 16, sizeof(rowCount));
+    if (version != kVersion) {
+        throw runtime_error("Unsupported columnar version " + to_string(version));
+    }
+
+    size_t pos = kFixedHeader;
+    for (uint32_t c = 0; c < count; c++) {
+        uint32_t length;
+        if (size - pos < sizeof(length)) {
+            throw runtime_error("Truncated columnar header");
+        }
+        memcpy(&length, p + pos, sizeof(length));
+        pos += sizeof(length);
+        if (length > size - pos) {
+            throw runtime_error("Truncated columnar header");
+        }
+        names.emplace_back(p + pos, length);
+        pos += length;
+    }
+
+    dataOffset = AlignUp(pos);
+    size_t available = dataOffset <= size ? (size - dataOffset) / sizeof(double) : 0;
+    if (dataOffset > size || (count > 0 && rowCount > available / count)) {
+        throw runtime_error("Columnar data is truncated");
+    }
+    rows = count > 0 ? static_cast<size_t>(rowCount) : 0;
+}
+
+void TDataset::OpenCsv() {
+    const char* p = file.Data();
+    size_t size = file.Size();
+    if (size == 0) {
+        throw runtime_error("Dataset is empty");
+    }
+
+    const char* newline = static_cast<const char*>(memchr(p, '\n', size));
+    size_t headerEnd = newline ? newline - p : size;
+    for (size_t pos = 0; pos <= headerEnd;) {
+        size_t comma = pos;
+        while (comma < headerEnd && p[comma] != ',') {
+            comma++;
+        }
+        size_t first = pos, last = comma;
+        while (first < last && IsBlank(p[first])) {
+            first++;
+        }
+        while (last > first && IsBlank(p[last - 1])) {
+            last--;
+        }
+        string name(p + first, last - first);
+        if (name.empty()) {
+            throw runtime_error("Empty column name in CSV header");
+        }
+        if (find(names.begin(), names.end(), name) != names.end()) {
+            throw runtime_error("Duplicate column in CSV header: " + name);
+        }
+        names.push_back(name);
+        pos = comma + 1;
+    }
+
+    // One pass over the lines to count rows and remember where each block
+    // starts, so that blocks can be parsed independently.
+    dataOffset = newline ? headerEnd + 1 : size;
+    for (size_t pos = dataOffset; pos < size;) {
+        const char* end = static_cast<const char*>(memchr(p + pos, '\n', size - pos));
+        size_t lineEnd = end ? end - p : size;
+        size_t i = pos;
+        while (i < lineEnd && IsBlank(p[i])) {
+            i++;
+        }
+        if (i < lineEnd) {
+            if (rows % kBlockRows == 0) {
+                blockOffsets.push_back(pos);
+            }
+            rows++;
+        }
+        pos = lineEnd + 1;
+    }
+}
+
+void TDataset::ParseCsvBlock(size_t block, double* const* dst) const {
+    const char* p = file.Data();
+    size_t size = file.Size();
+    size_t firstRow = block * kBlockRows;
+    size_t count = min(kBlockRows, rows - firstRow);
+    size_t pos = blockOffsets[block];
+
+    for (size_t r = 0; r < count;) {
+        const char* end = static_cast<const char*>(memchr(p + pos, '\n', size - pos));
+        size_t lineEnd = end ? end - p : size;
+        size_t lineStart = pos;
+        pos = lineEnd + 1;
+        while (lineStart < lineEnd && IsBlank(p[lineStart])) {
+            lineStart++;
+        }
+        if (lineStart == lineEnd) {
+            continue;
+        }
+
+        size_t column = 0;
+        for (size_t field = lineStart; field <= lineEnd; column++) {
+            size_t comma = field;
+            while (comma < lineEnd && p[comma] != ',') {
+                comma++;
+            }
+            if (column >= names.size()) {
+                throw runtime_error("Row " + to_string(firstRow + r + 1) + " has more than " +
+                    to_string(names.size()) + " fields");
+            }
+            if (dst[column]) {
+                const char* first = p + field;
+                const char* last = p + comma;
+                while (first < last && IsBlank(*first)) {
+                    first++;
+                }
+                while (last > first && IsBlank(last[-1])) {
+                    last--;
+                }
+                if (last - first > 1 && first[0] == '+' && first[1] != '-') {
+                    first++;
+                }
+                from_chars_result parsed = from_chars(first, last, dst[column][r]);
+                if (first == last || parsed.ec != errc() || parsed.ptr != last) {
+                    throw runtime_error("Invalid number in row " + to_string(firstRow + r + 1) +
+                        ", column " + names[column] + ": '" + string(p + field, comma - field) + "'");
+                }
+            }
+            field = comma + 1;
+        }
+        if (column != names.size()) {
+            throw runtime_error("Row " + to_string(firstRow + r + 1) + " has " + to_string(column) +
+                " fields, expected " + to_string(names.size()));
+        }
+        r++;
+    }
+}
+
+int TDataset::GetColumnIndex(const string& name) const {
+    for (size_t c = 0; c < names.size(); c++) {
+        if (names[c] == name) {
+            return static_cast<int>(c);
+        }
+    }
+    return -1;
+}
+
+const double* TDataset::GetColumn(size_t index) const {
+    if (!columnar || index >= names.size()) {
+        return nullptr;
+    }
+    return reinterpret_cast<const double*>(file.Data() + dataOffset) + index * rows;
+}
+
+void TDataset::Evaluate(const TArithmeticExpression& expr, double* out, TThreadPool& pool) const {
+    vector<string> operands = expr.GetOperands();
+    vector<size_t> columnOf(operands.size());
+    for (size_t slot = 0; slot < operands.size(); slot++) {
+        int column = GetColumnIndex(operands[slot]);
+        if (column < 0) {
+            throw invalid_argument("No column for variable: " + operands[slot]);
+        }
+        columnOf[slot] = column;
+    }
+
+    if (columnar) {
+        vector<const double*> columns(operands.size());
+        for (size_t slot = 0; slot < operands.size(); slot++) {
+            columns[slot] = GetColumn(columnOf[slot]);
+        }
+        expr.CalculateBatch(columns.data(), out, rows, pool);
+        return;
+    }
+
+    pool.ParallelFor(0, blockOffsets.size(), 1, [&](size_t first, size_t last) {
+        thread_local vector<double> buffer;
+        buffer.resize(operands.size() * kBlockRows);
+        vector<double*> dst(names.size(), nullptr);
+        vector<const double*> columns(operands.size());
+        for (size_t slot = 0; slot < operands.size(); slot++) {
+            dst[columnOf[slot]] = buffer.data() + slot * kBlockRows;
+            columns[slot] = dst[columnOf[slot]];
+        }
+        for (size_t block = first; block < last; block++) {
+            ParseCsvBlock(block, dst.data());
+            size_t firstRow = block * kBlockRows;
+            expr.CalculateBatch(columns.data(), out + firstRow, min(kBlockRows, rows - firstRow));
+        }
+    });
+}
+
+void TDataset::Evaluate(const TArithmeticExpression& expr, const string& outputPath, TThreadPool& pool) const {
+    vector<double*> columns;
+    TMappedFile output = CreateColumnar(outputPath, vector<string>(1, "result"), rows, columns);
+    Evaluate(expr, columns[0], pool);
+}
+
+void TDataset::WriteColumnar(const string& outputPath, TThreadPool& pool) const {
+    vector<double*> columns;
+    TMappedFile output = CreateColumnar(outputPath, names, rows, columns);
+
+    if (columnar) {
+        for (size_t c = 0; c < names.size(); c++) {
+            copy(GetColumn(c), GetColumn(c) + rows, columns[c]);
+        }
+        return;
+    }
+
+    pool.ParallelFor(0, blockOffsets.size(), 1, [&](size_t first, size_t last) {
+        vector<double*> dst(names.size());
+        for (size_t block = first; block < last; block++) {
+            for (size_t c = 0; c < names.size(); c++) {
+                dst[c] = columns[c] + block * kBlockRows;
+            }
+            ParseCsvBlock(block, dst.data());
+        }
+    });
+}
+
+void TDataset::WriteColumnar(const string& outputPath, const vector<string>& names,
+    const double* const* columns, size_t rows) {
+    vector<double*> mapped;
+    TMappedFile output = CreateColumnar(outputPath, names, rows, mapped);
+    for (size_t c = 0; c < names.size(); c++) {
+        copy(columns[c], columns[c] + rows, mapped[c]);
+    }
+}
@@ -0,0 +1,134 @@
+#include "TExpressionCache.h"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+using namespace std;
+
+namespace {
+
+bool IsWordChar(char c) {
+    return isalnum(static_cast<unsigned char>(c)) || c == '.';
+}
+
+// True if key[0, end) ends in a mantissa digit or point followed by e/E.
+bool EndsInExponentMark(const string& key, size_t end) {
+    return end >= 2 && (key[end - 1] == 'e' || key[end - 1] == 'E') &&
+        (isdigit(static_cast<unsigned char>(key[end - 2])) || key[end - 2] == '.');
+}
+
+// A blank between two word characters separates tokens, and so does one
+// after the e of an exponent or after its sign: "2e -3" is 2 times e minus 3.
+bool KeepsSpace(const string& key, char next) {
+    char last = key.back();
+    if (IsWordChar(last) && IsWordChar(next)) {
+        return true;
+    }
+    if ((next == '+' || next == '-') && EndsInExponentMark(key, key.size())) {
+        return true;
+    }
+    return isdigit(static_cast<unsigned char>(next)) && (last == '+' || last == '-') &&
+        EndsInExponentMark(key, key.size() - 1);
+}
+
+}
+
+TExpressionCache::TExpressionCache(size_t memoryBudget, size_t shardCount)
+    : hits(0), misses(0), evictions(0) {
+    shardCount = max<size_t>(shardCount, 1);
+    shardBudget = memoryBudget / shardCount;
+    for (size_t i = 0; i < shardCount; i++) {
+        shards.push_back(unique_ptr<Shard>(new Shard));
+        shards.back()->bytes = 0;
+    }
+}
+
+TExpressionCache::Shard& TExpressionCache::ShardFor(const string& key) {
+    return *shards[hash<string>()(key) % shards.size()];
+}
+
+string TExpressionCache::Normalize(const string& infix) {
+    string key;
+    key.reserve(infix.size());
+    bool pendingSpace = false;
+
+    for (char c : infix) {
+        if (isspace(static_cast<unsigned char>(c))) {
+            pendingSpace = true;
+            continue;
+        }
+        if (pendingSpace && !key.empty() && KeepsSpace(key, c)) {
+            key += ' ';
+        }
+        pendingSpace = false;
+        key += c;
+    }
+    return key;
+}
+
+TExpressionCache::Handle TExpressionCache::Get(const string& infix) {
+    string key = Normalize(infix);
+    Shard& shard = ShardFor(key);
+
+    {
+        lock_guard<mutex> lk(shard.lock);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            hits++;
+            return it->second->expr;
+        }
+    }
+
+    // Compile outside the lock; a concurrent miss on the same key compiles
+    // twice and the first one to insert wins.
+    misses++;
+    Handle expr = make_shared<const TArithmeticExpression>(infix);
+    size_t bytes = expr->GetMemoryUsage() + sizeof(Entry) + 2 * key.size();
+    if (bytes > shardBudget) {
+        return expr;
+    }
+
+    lock_guard<mutex> lk(shard.lock);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return it->second->expr;
+    }
+
+    while (shard.bytes + bytes > shardBudget && !shard.lru.empty()) {
+        shard.bytes -= shard.lru.back().bytes;
+        shard.index.erase(shard.lru.back().key);
+        shard.lru.pop_back();
+        evictions++;
+    }
+
+    shard.lru.push_front(Entry{ key, expr, bytes });
+    shard.index.emplace(key, shard.lru.begin());
+    shard.bytes += bytes;
+    return expr;
+}
+
+TExpressionCache::Stats TExpressionCache::GetStats() const {
+    Stats stats = { hits, misses, evictions, 0, 0 };
+    for (const auto& shard : shards) {
+        lock_guard<mutex> lk(shard->lock);
+        stats.entries += shard->lru.size();
+        stats.bytes += shard->bytes;
+    }
+    return stats;
+}
+
+void TExpressionCache::Clear() {
+    for (const auto& shard : shards) {
+        lock_guard<mutex> lk(shard->lock);
+        shard->lru.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+    }
+}
+
+TExpressionCache& TExpressionCache::Global() {
+    static TExpressionCache cache;
+    return cache;
+}
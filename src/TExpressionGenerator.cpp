@@ -0,0 +1,251 @@
+#include "TExpressionGenerator.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+uint64_t SplitMix64(uint64_t& x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+uint64_t RotateLeft(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// Full 64x64 -> 128-bit product from 32-bit halves.
+void Multiply(uint64_t a, uint64_t b, uint64_t& high, uint64_t& low) {
+    uint64_t aLow = a & 0xffffffffu, aHigh = a >> 32;
+    uint64_t bLow = b & 0xffffffffu, bHigh = b >> 32;
+    uint64_t ll = aLow * bLow, lh = aLow * bHigh, hl = aHigh * bLow, hh = aHigh * bHigh;
+    uint64_t middle = (ll >> 32) + (lh & 0xffffffffu) + (hl & 0xffffffffu);
+    low = (middle << 32) | (ll & 0xffffffffu);
+    high = hh + (lh >> 32) + (hl >> 32) + (middle >> 32);
+}
+
+struct Frame {
+    size_t remaining;
+    size_t depth;
+    bool closes;
+    bool wantOperand;
+    bool leafOnly;
+};
+
+}
+
+TRandom::TRandom(uint64_t seed) {
+    for (uint64_t& s : state) {
+        s = SplitMix64(seed);
+    }
+}
+
+uint64_t TRandom::Next() {
+    uint64_t result = RotateLeft(state[1] * 5, 7) * 9;
+    uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = RotateLeft(state[3], 45);
+    return result;
+}
+
+double TRandom::Uniform() {
+    return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Lemire's multiply-and-reject method.
+uint64_t TRandom::Below(uint64_t n) {
+    uint64_t high, low;
+    Multiply(Next(), n, high, low);
+    if (low < n) {
+        uint64_t threshold = (0 - n) % n;
+        while (low < threshold) {
+            Multiply(Next(), n, high, low);
+        }
+    }
+    return high;
+}
+
+TExpressionGenerator::TExpressionGenerator(const Options& opts) : options(opts), random(opts.seed), weightTotal(0) {
+    if (options.variables > 26) {
+        throw invalid_argument("At most 26 variables");
+    }
+    for (double w : options.operatorWeights) {
+        if (w < 0) {
+            throw invalid_argument("Operator weights must not be negative");
+        }
+        weightTotal += w;
+    }
+    if (weightTotal <= 0) {
+        throw invalid_argument("At least one operator needs a positive weight");
+    }
+}
+
+char TExpressionGenerator::PickOperator() {
+    static const char ops[] = { '+', '-', '*', '/' };
+    double r = random.Uniform() * weightTotal;
+    for (int k = 0; k < 3; k++) {
+        if (r < options.operatorWeights[k]) {
+            return ops[k];
+        }
+        r -= options.operatorWeights[k];
+    }
+    return options.operatorWeights[3] > 0 ? ops[3] : ops[2];
+}
+
+// Never zero: integers, fixed-point and exponent forms.
+void TExpressionGenerator::AppendLiteral(string& out) {
+    switch (random.Below(3)) {
+    case 0:
+        out += to_string(1 + random.Below(99));
+        break;
+    case 1: {
+        string fraction = to_string(random.Below(1000));
+        out += to_string(1 + random.Below(99));
+        out += '.';
+        out.append(3 - fraction.size(), '0');
+        out += fraction;
+        break;
+    }
+    default:
+        out += to_string(1 + random.Below(9));
+        out += '.';
+        out += to_string(random.Below(10));
+        out += random.Below(2) ? "e-" : "e+";
+        out += to_string(random.Below(4));
+        break;
+    }
+}
+
+string TExpressionGenerator::Next() {
+    string out;
+    out.reserve(options.tokens * 3);
+
+    // One frame per open parenthesis. An operand is a leaf, a parenthesised
+    // group or a sin/cos call; a group takes a random share of the frame's
+    // remaining tokens. Divisors are always leaves, and leaves are never zero,
+    // so expressions over non-zero variable values never divide by zero.
+    vector<Frame> frames;
+    frames.push_back(Frame{ max<size_t>(options.tokens, 1), 0, false, true, false });
+    while (!frames.empty()) {
+        Frame& f = frames.back();
+        if (!f.wantOperand) {
+            if (f.remaining >= 2) {
+                char op = PickOperator();
+                out += op;
+                f.remaining--;
+                f.wantOperand = true;
+                f.leafOnly = op == '/';
+            }
+            else {
+                // A single leftover token is handed back to the enclosing
+                // frame, so only the outermost one can fall short.
+                size_t leftover = f.remaining;
+                if (f.closes) {
+                    out += ')';
+                }
+                frames.pop_back();
+                if (!frames.empty()) {
+                    frames.back().remaining += leftover;
+                }
+            }
+            continue;
+        }
+
+        f.wantOperand = false;
+        double r = random.Uniform();
+        bool trig = r < options.trigFrequency;
+        bool group = !trig && r < options.trigFrequency + options.groupFrequency;
+        size_t overhead = trig ? 3 : 2;
+        if ((trig || group) && !f.leafOnly && f.depth < options.maxDepth && f.remaining > overhead) {
+            size_t share = 1 + static_cast<size_t>(random.Below(f.remaining - overhead));
+            f.remaining -= share + overhead;
+            if (trig) {
+                out += random.Below(2) ? "sin(" : "cos(";
+            }
+            else {
+                out += '(';
+            }
+            Frame child = { share, f.depth + 1, true, true, false };
+            frames.push_back(child);
+            continue;
+        }
+
+        f.remaining--;
+        if (options.variables == 0 || random.Uniform() < options.literalDensity) {
+            AppendLiteral(out);
+        }
+        else {
+            out += static_cast<char>('a' + random.Below(options.variables));
+        }
+    }
+    return out;
+}
+
+vector<string> TExpressionGenerator::GetVariables() const {
+    vector<string> names;
+    for (size_t v = 0; v < options.variables; v++) {
+        names.push_back(string(1, static_cast<char>('a' + v)));
+    }
+    return names;
+}
+
+vector<vector<double>> TExpressionGenerator::GenerateColumns(size_t variables, size_t rows, uint64_t seed,
+    double low, double high) {
+    vector<vector<double>> columns(variables, vector<double>(rows));
+    for (size_t v = 0; v < variables; v++) {
+        // A stream per column, so a column does not depend on the row count
+        // or on the other columns.
+        TRandom random(seed + 0x9e3779b97f4a7c15ull * (v + 1));
+        for (double& value : columns[v]) {
+            value = low + (high - low) * random.Uniform();
+        }
+    }
+    return columns;
+}
+
+size_t TExpressionGenerator::CountTokens(const string& expression) {
+    size_t tokens = 0;
+    size_t i = 0;
+    while (i < expression.size()) {
+        unsigned char c = expression[i];
+        if (isspace(c)) {
+            i++;
+            continue;
+        }
+        tokens++;
+        if (isalpha(c)) {
+            while (i < expression.size() && isalpha(static_cast<unsigned char>(expression[i]))) {
+                i++;
+            }
+        }
+        else if (isdigit(c) || c == '.') {
+            while (i < expression.size() && (isdigit(static_cast<unsigned char>(expression[i])) || expression[i] == '.')) {
+                i++;
+            }
+            if (i < expression.size() && (expression[i] == 'e' || expression[i] == 'E')) {
+                size_t digits = i + 1;
+                if (digits < expression.size() && (expression[digits] == '+' || expression[digits] == '-')) {
+                    digits++;
+                }
+                if (digits < expression.size() && isdigit(static_cast<unsigned char>(expression[digits]))) {
+                    i = digits;
+                    while (i < expression.size() && isdigit(static_cast<unsigned char>(expression[i]))) {
+                        i++;
+                    }
+                }
+            }
+        }
+        else {
+            i++;
+        }
+    }
+    return tokens;
+}
@@ -0,0 +1,217 @@
+#include "TExpressionOptimizer.h"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const size_t kNone = static_cast<size_t>(-1);
+
+}
+
+TExpressionOptimizer::TExpressionOptimizer(const pmr::vector<Instruction>& program, pmr::memory_resource* resource)
+    : nodes(resource), unique(resource), mask(0), root(kNone), deduplicated(0) {
+    pmr::vector<size_t> st(resource);
+    st.reserve(program.size());
+    nodes.reserve(program.size());
+
+    size_t tableSize = 16;
+    while (tableSize < 2 * program.size()) {
+        tableSize *= 2;
+    }
+    unique.assign(tableSize, Entry{ NodeKey{ Instruction::PUSH_NUMBER, kNone, kNone, 0 }, kNone });
+    mask = tableSize - 1;
+
+    for (const Instruction& ins : program) {
+        switch (ins.op) {
+        case Instruction::PUSH_NUMBER:
+            st.push_back(MakeLiteral(ins.value));
+            break;
+        case Instruction::PUSH_OPERAND:
+            st.push_back(AddNode(ins.op, kNone, kNone, ins.slot, 0));
+            break;
+        case Instruction::SIN:
+        case Instruction::COS:
+            if (st.empty()) {
+                throw invalid_argument("Malformed program");
+            }
+            st.back() = MakeUnary(ins.op, st.back());
+            break;
+        default: {
+            if (st.size() < 2) {
+                throw invalid_argument("Malformed program");
+            }
+            size_t right = st.back();
+            st.pop_back();
+            st.back() = MakeBinary(ins.op, st.back(), right);
+            break;
+        }
+        }
+    }
+
+    if (st.size() != 1) {
+        throw invalid_argument("Malformed program");
+    }
+    root = st.back();
+}
+
+size_t TExpressionOptimizer::HashKey(const NodeKey& key) {
+    uint64_t h = key.bits * 0x9E3779B97F4A7C15ull;
+    h ^= (static_cast<uint64_t>(key.left) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2));
+    h ^= (static_cast<uint64_t>(key.right) + 0x85EBCA77C2B2AE63ull + (h << 6) + (h >> 2));
+    h ^= static_cast<uint64_t>(key.op) * 0xC2B2AE3D27D4EB4Full;
+    return static_cast<size_t>(h ^ (h >> 29));
+}
+
+// Returns the existing node when an identical one was built before.
+// Operands of + and * are keyed in a fixed order, since IEEE addition and
+// multiplication are commutative.
+size_t TExpressionOptimizer::AddNode(Instruction::OpCode op, size_t left, size_t right, size_t slot, double value) {
+    NodeKey key = { op, left, right, slot };
+    if (op == Instruction::PUSH_NUMBER) {
+        memcpy(&key.bits, &value, sizeof(value));
+    }
+    if ((op == Instruction::ADD || op == Instruction::MUL) && key.right < key.left) {
+        swap(key.left, key.right);
+    }
+
+    size_t i = HashKey(key) & mask;
+    for (; unique[i].id != kNone; i = (i + 1) & mask) {
+        if (unique[i].key == key) {
+            if (op != Instruction::PUSH_NUMBER && op != Instruction::PUSH_OPERAND) {
+                deduplicated++;
+            }
+            return unique[i].id;
+        }
+    }
+
+    nodes.push_back(Node{ op, left, right, slot, value });
+    unique[i] = Entry{ key, nodes.size() - 1 };
+    return nodes.size() - 1;
+}
+
+size_t TExpressionOptimizer::MakeLiteral(double value) {
+    return AddNode(Instruction::PUSH_NUMBER, kNone, kNone, 0, value);
+}
+
+bool TExpressionOptimizer::IsLiteral(size_t node, double value) const {
+    const Node& n = nodes[node];
+    // Compare bit patterns, so that 0 and -0 are told apart.
+    return n.op == Instruction::PUSH_NUMBER && memcmp(&n.value, &value, sizeof(value)) == 0;
+}
+
+size_t TExpressionOptimizer::MakeUnary(Instruction::OpCode op, size_t arg) {
+    if (nodes[arg].op == Instruction::PUSH_NUMBER) {
+        double v = nodes[arg].value;
+        return MakeLiteral(op == Instruction::SIN ? sin(v) : cos(v));
+    }
+    return AddNode(op, arg, kNone, 0, 0);
+}
+
+size_t TExpressionOptimizer::MakeBinary(Instruction::OpCode op, size_t left, size_t right) {
+    const Node& l = nodes[left];
+    const Node& r = nodes[right];
+
+    if (l.op == Instruction::PUSH_NUMBER && r.op == Instruction::PUSH_NUMBER &&
+        !(op == Instruction::DIV && r.value == 0.0)) {
+        switch (op) {
+        case Instruction::ADD: return MakeLiteral(l.value + r.value);
+        case Instruction::SUB: return MakeLiteral(l.value - r.value);
+        case Instruction::MUL: return MakeLiteral(l.value * r.value);
+        default: return MakeLiteral(l.value / r.value);
+        }
+    }
+
+    switch (op) {
+    case Instruction::MUL:
+        if (IsLiteral(right, 1.0)) return left;
+        if (IsLiteral(left, 1.0)) return right;
+        break;
+    case Instruction::DIV:
+        if (IsLiteral(right, 1.0)) return left;
+        break;
+    case Instruction::SUB:
+        if (IsLiteral(right, 0.0)) return left;
+        break;
+    case Instruction::ADD:
+        if (IsLiteral(right, -0.0)) return left;
+        if (IsLiteral(left, -0.0)) return right;
+        break;
+    default:
+        break;
+    }
+
+    return AddNode(op, left, right, 0, 0);
+}
+
+pmr::vector<Instruction> TExpressionOptimizer::GetProgram() const {
+    pmr::memory_resource* resource = nodes.get_allocator().resource();
+
+    // Operations reachable more than once get a temporary.
+    pmr::vector<size_t> uses(nodes.size(), 0, resource);
+    pmr::vector<size_t> pending(resource);
+    pending.reserve(nodes.size());
+    pending.push_back(root);
+    uses[root] = 1;
+    while (!pending.empty()) {
+        const Node& n = nodes[pending.back()];
+        pending.pop_back();
+        size_t children[] = { n.left, n.right };
+        for (size_t child : children) {
+            if (child != kNone && uses[child]++ == 0) {
+                pending.push_back(child);
+            }
+        }
+    }
+
+    // Every node is emitted once, plus a store and at most one load per use.
+    size_t edges = 0;
+    for (size_t count : uses) {
+        edges += count;
+    }
+    pmr::vector<Instruction> program(resource);
+    program.reserve(nodes.size() + edges);
+    pmr::vector<size_t> temp(nodes.size(), kNone, resource);
+    size_t temps = 0;
+
+    // Post-order walk with an explicit stack: machine-generated expressions
+    // can be nested far deeper than the call stack allows.
+    pmr::vector<pair<size_t, bool>> st(resource);
+    st.reserve(nodes.size() + edges);
+    st.push_back(make_pair(root, false));
+
+    while (!st.empty()) {
+        size_t id = st.back().first;
+        bool expanded = st.back().second;
+        st.pop_back();
+        const Node& n = nodes[id];
+
+        if (n.op == Instruction::PUSH_NUMBER) {
+            program.push_back(Instruction(Instruction::PUSH_NUMBER, 0, n.value));
+        }
+        else if (n.op == Instruction::PUSH_OPERAND) {
+            program.push_back(Instruction(Instruction::PUSH_OPERAND, n.slot));
+        }
+        else if (temp[id] != kNone) {
+            program.push_back(Instruction(Instruction::LOAD_TEMP, temp[id]));
+        }
+        else if (expanded) {
+            program.push_back(Instruction(n.op));
+            if (uses[id] > 1) {
+                temp[id] = temps++;
+                program.push_back(Instruction(Instruction::STORE_TEMP, temp[id]));
+            }
+        }
+        else {
+            st.push_back(make_pair(id, true));
+            if (n.right != kNone) {
+                st.push_back(make_pair(n.right, false));
+            }
+            st.push_back(make_pair(n.left, false));
+        }
+    }
+
+    return program;
+}
@@ -0,0 +1,235 @@
+#include "TInstrumentation.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+const char* const TInstrumentation::kPhaseNames[PHASE_COUNT] = {
+    "parse", "to_postfix", "compile", "evaluate", "evaluate_batch"
+};
+
+const char* const TInstrumentation::kCounterNames[COUNTER_COUNT] = {
+    "expressions", "tokens", "batch_rows", "stack_growths", "stack_high_water"
+};
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+const Clock::time_point kEpoch = Clock::now();
+
+struct Event {
+    TInstrumentation::Phase phase;
+    int64_t begin;      // ns since kEpoch
+    int64_t duration;   // ns
+};
+
+// Written only by its thread; atomics so that Take() may read concurrently.
+struct ThreadBlock {
+    atomic<uint64_t> calls[TInstrumentation::PHASE_COUNT];
+    atomic<uint64_t> nanoseconds[TInstrumentation::PHASE_COUNT];
+    atomic<uint64_t> counters[TInstrumentation::COUNTER_COUNT];
+    mutex eventLock;
+    vector<Event> events;
+    uint32_t id;
+};
+
+struct Registry {
+    mutex lock;
+    vector<ThreadBlock*> live;
+    TInstrumentation::Snapshot retired;
+    vector<pair<uint32_t, Event>> retiredEvents;
+    uint32_t nextId;
+};
+
+atomic<bool> tracing(false);
+
+// Never destroyed: threads may exit after static destruction has begun.
+Registry& GetRegistry() {
+    static Registry* registry = [] {
+        Registry* r = new Registry;
+        memset(&r->retired, 0, sizeof(r->retired));
+        r->nextId = 1;
+        return r;
+    }();
+    return *registry;
+}
+
+void Bump(atomic<uint64_t>& value, uint64_t n) {
+    value.store(value.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+void Accumulate(TInstrumentation::Snapshot& total, const ThreadBlock& block) {
+    for (int p = 0; p < TInstrumentation::PHASE_COUNT; p++) {
+        total.calls[p] += block.calls[p].load(memory_order_relaxed);
+        total.nanoseconds[p] += block.nanoseconds[p].load(memory_order_relaxed);
+    }
+    for (int c = 0; c < TInstrumentation::COUNTER_COUNT; c++) {
+        uint64_t value = block.counters[c].load(memory_order_relaxed);
+        if (c == TInstrumentation::STACK_HIGH_WATER) {
+            total.counters[c] = max(total.counters[c], value);
+        }
+        else {
+            total.counters[c] += value;
+        }
+    }
+}
+
+void Zero(ThreadBlock& block) {
+    for (int p = 0; p < TInstrumentation::PHASE_COUNT; p++) {
+        block.calls[p].store(0, memory_order_relaxed);
+        block.nanoseconds[p].store(0, memory_order_relaxed);
+    }
+    for (int c = 0; c < TInstrumentation::COUNTER_COUNT; c++) {
+        block.counters[c].store(0, memory_order_relaxed);
+    }
+}
+
+// Registers the thread's block on first use and folds it into the retired
+// totals when the thread exits.
+struct LocalHandle {
+    ThreadBlock* block;
+
+    LocalHandle() : block(new ThreadBlock) {
+        Zero(*block);
+        Registry& registry = GetRegistry();
+        lock_guard<mutex> guard(registry.lock);
+        block->id = registry.nextId++;
+        registry.live.push_back(block);
+    }
+
+    ~LocalHandle() {
+        Registry& registry = GetRegistry();
+        lock_guard<mutex> guard(registry.lock);
+        Accumulate(registry.retired, *block);
+        for (const Event& event : block->events) {
+            registry.retiredEvents.emplace_back(block->id, event);
+        }
+        registry.live.erase(find(registry.live.begin(), registry.live.end(), block));
+        delete block;
+    }
+};
+
+ThreadBlock& Local() {
+    thread_local LocalHandle handle;
+    return *handle.block;
+}
+
+// Microseconds with three decimals keep every nanosecond, however long the
+// process has been running.
+void WriteEvent(ostream& out, bool first, uint32_t thread, const Event& event) {
+    char times[96];
+    snprintf(times, sizeof(times), "\"ts\": %.3f, \"dur\": %.3f", event.begin / 1000.0, event.duration / 1000.0);
+    out << (first ? "\n" : ",\n") << "  {\"name\": \"" << TInstrumentation::kPhaseNames[event.phase]
+        << "\", \"cat\": \"calc\", \"ph\": \"X\", " << times << ", \"pid\": 1, \"tid\": " << thread << "}";
+}
+
+}
+
+TInstrumentation::Snapshot TInstrumentation::Take() {
+    Registry& registry = GetRegistry();
+    lock_guard<mutex> guard(registry.lock);
+    Snapshot total = registry.retired;
+    for (const ThreadBlock* block : registry.live) {
+        Accumulate(total, *block);
+    }
+    return total;
+}
+
+void TInstrumentation::Reset() {
+    Registry& registry = GetRegistry();
+    lock_guard<mutex> guard(registry.lock);
+    memset(&registry.retired, 0, sizeof(registry.retired));
+    registry.retiredEvents.clear();
+    for (ThreadBlock* block : registry.live) {
+        Zero(*block);
+        lock_guard<mutex> events(block->eventLock);
+        block->events.clear();
+    }
+}
+
+void TInstrumentation::Add(Counter counter, uint64_t n) {
+    Bump(Local().counters[counter], n);
+}
+
+void TInstrumentation::Max(Counter counter, uint64_t value) {
+    atomic<uint64_t>& current = Local().counters[counter];
+    if (value > current.load(memory_order_relaxed)) {
+        current.store(value, memory_order_relaxed);
+    }
+}
+
+void TInstrumentation::AddPhase(Phase phase, Clock::time_point start, Clock::time_point end) {
+    ThreadBlock& block = Local();
+    int64_t duration = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+    Bump(block.calls[phase], 1);
+    Bump(block.nanoseconds[phase], static_cast<uint64_t>(duration));
+    if (tracing.load(memory_order_relaxed)) {
+        int64_t begin = chrono::duration_cast<chrono::nanoseconds>(start - kEpoch).count();
+        lock_guard<mutex> guard(block.eventLock);
+        block.events.push_back(Event{ phase, begin, duration });
+    }
+}
+
+void TInstrumentation::StartTrace() {
+    tracing.store(true);
+}
+
+void TInstrumentation::StopTrace() {
+    tracing.store(false);
+}
+
+void TInstrumentation::WriteTrace(ostream& out) {
+    Registry& registry = GetRegistry();
+    lock_guard<mutex> guard(registry.lock);
+    bool first = true;
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    for (const auto& retired : registry.retiredEvents) {
+        WriteEvent(out, first, retired.first, retired.second);
+        first = false;
+    }
+    for (ThreadBlock* block : registry.live) {
+        lock_guard<mutex> events(block->eventLock);
+        for (const Event& event : block->events) {
+            WriteEvent(out, first, block->id, event);
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+}
+
+void TInstrumentation::WriteText(ostream& out, const Snapshot& snapshot) {
+    char line[128];
+    snprintf(line, sizeof(line), "%-16s %12s %14s %12s\n", "phase", "calls", "total ms", "mean ns");
+    out << line;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        uint64_t calls = snapshot.calls[p];
+        snprintf(line, sizeof(line), "%-16s %12llu %14.3f %12.1f\n", kPhaseNames[p],
+            static_cast<unsigned long long>(calls), snapshot.nanoseconds[p] / 1e6,
+            calls ? static_cast<double>(snapshot.nanoseconds[p]) / calls : 0.0);
+        out << line;
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        snprintf(line, sizeof(line), "%-16s %12llu\n", kCounterNames[c],
+            static_cast<unsigned long long>(snapshot.counters[c]));
+        out << line;
+    }
+}
+
+void TInstrumentation::WriteJson(ostream& out, const Snapshot& snapshot) {
+    out << "{\"enabled\": " << (Enabled() ? "true" : "false") << ", \"phases\": {";
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        out << (p ? ", " : "") << "\"" << kPhaseNames[p] << "\": {\"calls\": " << snapshot.calls[p]
+            << ", \"ns\": " << snapshot.nanoseconds[p] << "}";
+    }
+    out << "}, \"counters\": {";
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        out << (c ? ", " : "") << "\"" << kCounterNames[c] << "\": " << snapshot.counters[c];
+    }
+    out << "}}\n";
+}
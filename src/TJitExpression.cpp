@@ -0,0 +1,307 @@
+#include "TJitExpression.h"
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define CALC_JIT_X64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#if CALC_JIT_X64
+namespace {
+
+// Registers as encoded in ModRM/REX.
+const int kRbx = 3;
+const int kRsp = 4;
+const int kScratchZero = 15;
+
+// SSE2 opcodes after the 0F escape byte.
+const uint8_t kMovsdLoad = 0x10;
+const uint8_t kMovsdStore = 0x11;
+const uint8_t kAddsd = 0x58;
+const uint8_t kMulsd = 0x59;
+const uint8_t kSubsd = 0x5C;
+const uint8_t kDivsd = 0x5E;
+const uint8_t kUcomisd = 0x2E;
+const uint8_t kXorpd = 0x57;
+const uint8_t kMovapd = 0x28;
+
+// Stack frame below the two saved registers: one spill slot per register,
+// then the program's temporaries, padded so that rsp stays 16-byte aligned at calls.
+const int32_t kTempBase = 8 * static_cast<int32_t>(TJitExpression::kMaxRegisters);
+
+int32_t FrameSize(size_t temps) {
+    int32_t size = kTempBase + 8 * static_cast<int32_t>(temps);
+    return size % 16 == 0 ? size + 8 : size;
+}
+
+class X64Emitter
+{
+    vector<uint8_t> code;
+    vector<double> literals;
+    vector<pair<size_t, size_t>> literalFixups;   // disp32 position, literal index
+    vector<size_t> errorFixups;                    // rel32 positions jumping to the error exit
+    int32_t frameSize;
+
+    void Byte(uint8_t b) { code.push_back(b); }
+
+    void Dword(uint32_t v) {
+        for (int i = 0; i < 4; i++) Byte(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    void Qword(uint64_t v) {
+        for (int i = 0; i < 8; i++) Byte(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    void Patch32(size_t at, int32_t v) {
+        for (int i = 0; i < 4; i++) code[at + i] = static_cast<uint8_t>(static_cast<uint32_t>(v) >> (8 * i));
+    }
+
+    void Rex(int reg, int rm) {
+        if (reg >= 8 || rm >= 8) Byte(static_cast<uint8_t>(0x40 | ((reg >> 3) << 2) | (rm >> 3)));
+    }
+
+    // Only the double-precision forms: F2 for scalar ops, 66 for packed/compare.
+    static uint8_t Prefix(uint8_t op) {
+        return (op == kUcomisd || op == kXorpd || op == kMovapd) ? 0x66 : 0xF2;
+    }
+
+public:
+    explicit X64Emitter(size_t temps) : frameSize(FrameSize(temps)) {}
+
+    void SseRegReg(uint8_t op, int dst, int src) {
+        Byte(Prefix(op));
+        Rex(dst, src);
+        Byte(0x0F);
+        Byte(op);
+        Byte(static_cast<uint8_t>(0xC0 | ((dst & 7) << 3) | (src & 7)));
+    }
+
+    // op xmm, [base + disp32] (or the store direction for movsd 0x11).
+    void SseRegMem(uint8_t op, int reg, int base, int32_t disp) {
+        Byte(Prefix(op));
+        Rex(reg, base);
+        Byte(0x0F);
+        Byte(op);
+        Byte(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+        if ((base & 7) == kRsp) Byte(0x24);
+        Dword(static_cast<uint32_t>(disp));
+    }
+
+    void LoadLiteral(int reg, double value) {
+        Byte(0xF2);
+        Rex(reg, 0);
+        Byte(0x0F);
+        Byte(kMovsdLoad);
+        Byte(static_cast<uint8_t>(((reg & 7) << 3) | 5));   // [rip + disp32]
+        literalFixups.push_back(make_pair(code.size(), literals.size()));
+        literals.push_back(value);
+        Dword(0);
+    }
+
+    void Prologue() {
+        Byte(0x53);                                   // push rbx
+        Byte(0x41); Byte(0x54);                       // push r12
+        Byte(0x48); Byte(0x81); Byte(0xEC); Dword(frameSize);  // sub rsp, frame
+        Byte(0x48); Byte(0x89); Byte(0xFB);           // mov rbx, rdi (values)
+        Byte(0x49); Byte(0x89); Byte(0xF4);           // mov r12, rsi (status)
+    }
+
+    // Division by zero: jump to the error exit unless the divisor is non-zero or NaN.
+    void CheckDivisor(int reg) {
+        SseRegReg(kXorpd, kScratchZero, kScratchZero);
+        SseRegReg(kUcomisd, reg, kScratchZero);
+        Byte(0x7A); Byte(0x06);                       // jp +6 (unordered)
+        Byte(0x0F); Byte(0x84);                       // je error
+        errorFixups.push_back(code.size());
+        Dword(0);
+    }
+
+    // Calls fn(xmm<arg>) with slots [0, live) preserved; the result replaces xmm<arg>.
+    void CallUnary(double (*fn)(double), int arg, int live) {
+        for (int i = 0; i < live; i++) SseRegMem(kMovsdStore, i, kRsp, 8 * i);
+        if (arg != 0) SseRegReg(kMovapd, 0, arg);
+        Byte(0x48); Byte(0xB8); Qword(reinterpret_cast<uint64_t>(fn));  // mov rax, fn
+        Byte(0xFF); Byte(0xD0);                       // call rax
+        if (arg != 0) SseRegReg(kMovapd, arg, 0);
+        for (int i = 0; i < live; i++) {
+            if (i != arg) SseRegMem(kMovsdLoad, i, kRsp, 8 * i);
+        }
+    }
+
+    // Epilogue, error exit and literal pool; returns the finished image.
+    vector<uint8_t> Finish() {
+        size_t epilogue = code.size();
+        Byte(0x48); Byte(0x81); Byte(0xC4); Dword(frameSize);  // add rsp, frame
+        Byte(0x41); Byte(0x5C);                       // pop r12
+        Byte(0x5B);                                   // pop rbx
+        Byte(0xC3);                                   // ret
+
+        size_t error = code.size();
+        Byte(0x41); Byte(0xC7); Byte(0x04); Byte(0x24); Dword(1);   // mov dword [r12], 1
+        Byte(0xE9);                                   // jmp epilogue
+        Dword(static_cast<uint32_t>(static_cast<int32_t>(epilogue - (code.size() + 4))));
+
+        for (size_t at : errorFixups) Patch32(at, static_cast<int32_t>(error - (at + 4)));
+
+        while (code.size() % 8) Byte(0xCC);
+        size_t pool = code.size();
+        for (double v : literals) {
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            Qword(bits);
+        }
+        for (const auto& fix : literalFixups) {
+            Patch32(fix.first, static_cast<int32_t>(pool + 8 * fix.second - (fix.first + 4)));
+        }
+        return code;
+    }
+};
+
+double Sin(double x) { return sin(x); }
+double Cos(double x) { return cos(x); }
+
+vector<uint8_t> Generate(const TArithmeticExpression& expr) {
+    X64Emitter e(expr.GetTempCount());
+    e.Prologue();
+
+    int depth = 0;
+    for (const Instruction& ins : expr.GetProgram()) {
+        switch (ins.op) {
+        case Instruction::PUSH_NUMBER:
+            e.LoadLiteral(depth++, ins.value);
+            break;
+        case Instruction::PUSH_OPERAND:
+            e.SseRegMem(kMovsdLoad, depth++, kRbx, static_cast<int32_t>(8 * ins.slot));
+            break;
+        case Instruction::ADD:
+            e.SseRegReg(kAddsd, depth - 2, depth - 1);
+            depth--;
+            break;
+        case Instruction::SUB:
+            e.SseRegReg(kSubsd, depth - 2, depth - 1);
+            depth--;
+            break;
+        case Instruction::MUL:
+            e.SseRegReg(kMulsd, depth - 2, depth - 1);
+            depth--;
+            break;
+        case Instruction::DIV:
+            e.CheckDivisor(depth - 1);
+            e.SseRegReg(kDivsd, depth - 2, depth - 1);
+            depth--;
+            break;
+        case Instruction::SIN:
+            e.CallUnary(Sin, depth - 1, depth);
+            break;
+        case Instruction::COS:
+            e.CallUnary(Cos, depth - 1, depth);
+            break;
+        case Instruction::STORE_TEMP:
+            e.SseRegMem(kMovsdStore, depth - 1, kRsp, kTempBase + 8 * static_cast<int32_t>(ins.slot));
+            break;
+        case Instruction::LOAD_TEMP:
+            e.SseRegMem(kMovsdLoad, depth++, kRsp, kTempBase + 8 * static_cast<int32_t>(ins.slot));
+            break;
+        }
+    }
+
+    return e.Finish();
+}
+
+atomic<int> perfMapCounter(0);
+
+void WritePerfMap(const void* code, size_t size, const string& infix) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/perf-%d.map", static_cast<int>(getpid()));
+    FILE* f = fopen(path, "a");
+    if (!f) {
+        return;
+    }
+    string name;
+    for (char c : infix) {
+        if (!isspace(static_cast<unsigned char>(c))) name += c;
+    }
+    if (name.size() > 64) {
+        name = name.substr(0, 64) + "...";
+    }
+    fprintf(f, "%lx %lx calc_jit_%d[%s]\n", reinterpret_cast<unsigned long>(code),
+        static_cast<unsigned long>(size), perfMapCounter++, name.c_str());
+    fclose(f);
+}
+
+}
+#endif
+
+TJitExpression::TJitExpression(const TArithmeticExpression& expression, bool writePerfMap)
+    : expr(expression), code(nullptr), codeSize(0), function(nullptr) {
+    Compile(writePerfMap);
+}
+
+TJitExpression::~TJitExpression() {
+#if CALC_JIT_X64
+    if (code) {
+        munmap(code, codeSize);
+    }
+#endif
+}
+
+bool TJitExpression::IsSupported() {
+#if CALC_JIT_X64
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TJitExpression::Compile(bool writePerfMap) {
+#if CALC_JIT_X64
+    if (!expr.GetProgramError().empty() || expr.GetStackDepth() > kMaxRegisters ||
+        expr.GetTempCount() > kMaxTemps) {
+        return;
+    }
+
+    vector<uint8_t> image = Generate(expr);
+    void* mem = mmap(nullptr, image.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return;
+    }
+    memcpy(mem, image.data(), image.size());
+    if (mprotect(mem, image.size(), PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, image.size());
+        return;
+    }
+
+    code = mem;
+    codeSize = image.size();
+    function = reinterpret_cast<Function>(mem);
+
+    if (writePerfMap) {
+        WritePerfMap(code, codeSize, expr.GetInfix());
+    }
+#else
+    (void)writePerfMap;
+#endif
+}
+
+double TJitExpression::Calculate(const double* values) const {
+    if (!function) {
+        return expr.Calculate(values);
+    }
+
+    int status = 0;
+    double result = function(values, &status);
+    if (status != 0) {
+        throw runtime_error("Division by zero");
+    }
+    return result;
+}
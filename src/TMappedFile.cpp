@@ -0,0 +1,114 @@
+#include "TMappedFile.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CALC_POSIX_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#if CALC_POSIX_MMAP
+namespace {
+
+[[noreturn]] void Fail(const char* what, const string& path) {
+    throw runtime_error(string(what) + " " + path + ": " + strerror(errno));
+}
+
+// Closes the descriptor once the mapping exists; the mapping keeps the file.
+struct TDescriptor {
+    int fd;
+    ~TDescriptor() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+}
+
+TMappedFile::TMappedFile(const string& path) : data(nullptr), size(0) {
+    TDescriptor file = { open(path.c_str(), O_RDONLY) };
+    if (file.fd < 0) {
+        Fail("Cannot open", path);
+    }
+    struct stat info;
+    if (fstat(file.fd, &info) != 0) {
+        Fail("Cannot stat", path);
+    }
+    size = static_cast<size_t>(info.st_size);
+    if (size == 0) {
+        return;
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, file.fd, 0);
+    if (mapped == MAP_FAILED) {
+        size = 0;
+        Fail("Cannot map", path);
+    }
+    // Datasets are read front to back; let the kernel read ahead.
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    data = static_cast<char*>(mapped);
+}
+
+TMappedFile::TMappedFile(const string& path, size_t length) : data(nullptr), size(length) {
+    TDescriptor file = { open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) };
+    if (file.fd < 0) {
+        Fail("Cannot create", path);
+    }
+    if (ftruncate(file.fd, static_cast<off_t>(size)) != 0) {
+        Fail("Cannot resize", path);
+    }
+    if (size == 0) {
+        return;
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+    if (mapped == MAP_FAILED) {
+        size = 0;
+        Fail("Cannot map", path);
+    }
+    data = static_cast<char*>(mapped);
+}
+
+void TMappedFile::Release() {
+    if (data) {
+        munmap(data, size);
+    }
+    data = nullptr;
+    size = 0;
+}
+#else
+TMappedFile::TMappedFile(const string&) : data(nullptr), size(0) {
+    throw runtime_error("Memory-mapped files are not supported on this platform");
+}
+
+TMappedFile::TMappedFile(const string&, size_t) : data(nullptr), size(0) {
+    throw runtime_error("Memory-mapped files are not supported on this platform");
+}
+
+void TMappedFile::Release() {}
+#endif
+
+TMappedFile::~TMappedFile() {
+    Release();
+}
+
+TMappedFile::TMappedFile(TMappedFile&& other) noexcept : data(other.data), size(other.size) {
+    other.data = nullptr;
+    other.size = 0;
+}
+
+TMappedFile& TMappedFile::operator=(TMappedFile&& other) noexcept {
+    if (this != &other) {
+        Release();
+        data = other.data;
+        size = other.size;
+        other.data = nullptr;
+        other.size = 0;
+    }
+    return *this;
+}
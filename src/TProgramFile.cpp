@@ -0,0 +1,214 @@
+#include "TProgramFile.h"
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace std;
+
+namespace {
+
+const char kMagic[8] = { 'C', 'A', 'L', 'C', 'P', 'R', 'O', 'G' };
+const uint32_t kVersion = 1;
+const uint32_t kByteOrderMark = 0x01020304;
+const size_t kHeaderSize = 32;
+
+static_assert(is_trivially_copyable<Instruction>::value && is_standard_layout<Instruction>::value,
+    "Instructions are used in place from the mapping");
+static_assert(sizeof(TProgramFile::Entry) == 48, "Directory entries have a fixed size");
+
+typedef underlying_type<Instruction::OpCode>::type RawOpCode;
+
+size_t AlignUp(size_t offset) {
+    return (offset + alignof(Instruction) - 1) & ~(alignof(Instruction) - 1);
+}
+
+bool Within(uint64_t offset, uint64_t length, size_t size) {
+    return offset <= size && length <= size - offset;
+}
+
+// A loaded program together with the mapping its instructions live in.
+struct TMappedProgram {
+    shared_ptr<const TMappedFile> file;
+    TCompiledProgram program;
+
+    TMappedProgram(shared_ptr<const TMappedFile> f, const Instruction* code, size_t count,
+        const pmr::vector<pmr::string>& names, pmr::memory_resource* resource)
+        : file(move(f)), program(code, count, names, resource) {}
+};
+
+}
+
+TProgramFile::TProgramFile(const string& path) : file(make_shared<const TMappedFile>(path)), count(0) {
+    const char* p = file->Data();
+    size_t size = file->Size();
+    if (size < kHeaderSize || memcmp(p, kMagic, sizeof(kMagic)) != 0) {
+        throw runtime_error("Not a program file: " + path);
+    }
+
+    uint32_t version, byteOrder, instructionSize, programs;
+    uint64_t fileSize;
+    memcpy(&version, p + 8, sizeof(version));
+    memcpy(&byteOrder, p + 12, sizeof(byteOrder));
+    memcpy(&instructionSize, p + 16, sizeof(instructionSize));
+    memcpy(&programs, p + 20, sizeof(programs));
+    memcpy(&fileSize, p + 24, sizeof(fileSize));
+    if (version != kVersion) {
+        throw runtime_error("Unsupported program file version " + to_string(version));
+    }
+    if (byteOrder != kByteOrderMark || instructionSize != sizeof(Instruction)) {
+        throw runtime_error("Program file was written on an incompatible platform");
+    }
+    if (fileSize != size || programs > (size - kHeaderSize) / sizeof(Entry)) {
+        throw runtime_error("Program file is truncated");
+    }
+    count = programs;
+
+    for (size_t i = 0; i < count; i++) {
+        Entry entry = GetEntry(i);
+        if (entry.codeOffset % alignof(Instruction) != 0 ||
+            !Within(entry.codeOffset, 0, size) ||
+            entry.codeCount > (size - entry.codeOffset) / sizeof(Instruction) ||
+            !Within(entry.namesOffset, entry.namesSize, size) ||
+            !Within(entry.sourceOffset, entry.sourceLength, size)) {
+            throw runtime_error("Program " + to_string(i) + " lies outside the program file");
+        }
+    }
+}
+
+TProgramFile::Entry TProgramFile::GetEntry(size_t index) const {
+    Entry entry;
+    memcpy(&entry, file->Data() + kHeaderSize + index * sizeof(Entry), sizeof(Entry));
+    return entry;
+}
+
+shared_ptr<const TCompiledProgram> TProgramFile::GetProgram(size_t index, pmr::memory_resource* resource) const {
+    if (index >= count) {
+        throw out_of_range("Program index out of range");
+    }
+    Entry entry = GetEntry(index);
+    const char* p = file->Data();
+
+    // Opcodes are checked as raw integers before any is read as an OpCode.
+    const char* code = p + entry.codeOffset;
+    for (size_t i = 0; i < entry.codeCount; i++) {
+        RawOpCode op;
+        memcpy(&op, code + i * sizeof(Instruction) + offsetof(Instruction, op), sizeof(op));
+        if (op < Instruction::PUSH_NUMBER || op > Instruction::LOAD_TEMP) {
+            throw runtime_error("Program " + to_string(index) + " has an unknown instruction");
+        }
+    }
+
+    pmr::vector<pmr::string> names(resource);
+    names.reserve(entry.nameCount);
+    const char* table = p + entry.namesOffset;
+    size_t pos = 0;
+    for (uint32_t k = 0; k < entry.nameCount; k++) {
+        uint32_t length;
+        if (entry.namesSize - pos < sizeof(length)) {
+            throw runtime_error("Program " + to_string(index) + " has a truncated variable table");
+        }
+        memcpy(&length, table + pos, sizeof(length));
+        pos += sizeof(length);
+        if (length > entry.namesSize - pos) {
+            throw runtime_error("Program " + to_string(index) + " has a truncated variable table");
+        }
+        names.emplace_back(table + pos, length);
+        pos += length;
+        if (k > 0 && !(names[k - 1] < names[k])) {
+            throw runtime_error("Program " + to_string(index) + " has an unsorted variable table");
+        }
+    }
+
+    auto loaded = allocate_shared<TMappedProgram>(pmr::polymorphic_allocator<TMappedProgram>(resource),
+        file, reinterpret_cast<const Instruction*>(code), static_cast<size_t>(entry.codeCount), names, resource);
+    if (!loaded->program.GetError().empty()) {
+        throw runtime_error("Program " + to_string(index) + " is malformed: " + loaded->program.GetError());
+    }
+    return shared_ptr<const TCompiledProgram>(loaded, &loaded->program);
+}
+
+string_view TProgramFile::GetSource(size_t index) const {
+    if (index >= count) {
+        throw out_of_range("Program index out of range");
+    }
+    Entry entry = GetEntry(index);
+    return string_view(file->Data() + entry.sourceOffset, entry.sourceLength);
+}
+
+void TProgramFile::Write(const string& path, const vector<shared_ptr<const TCompiledProgram>>& programs,
+    const vector<string>& sources) {
+    if (!sources.empty() && sources.size() != programs.size()) {
+        throw invalid_argument("Need one source per program");
+    }
+
+    vector<Entry> entries(programs.size());
+    size_t size = kHeaderSize + programs.size() * sizeof(Entry);
+    for (size_t i = 0; i < programs.size(); i++) {
+        const TCompiledProgram& program = *programs[i];
+        if (!program.GetError().empty()) {
+            throw invalid_argument("Cannot write a malformed program: " + program.GetError());
+        }
+        Entry& entry = entries[i];
+        memset(&entry, 0, sizeof(entry));
+        size = AlignUp(size);
+        entry.codeOffset = size;
+        entry.codeCount = program.GetInstructionCount();
+        size += program.GetInstructionCount() * sizeof(Instruction);
+
+        entry.namesOffset = size;
+        entry.nameCount = static_cast<uint32_t>(program.GetOperands().size());
+        for (const pmr::string& name : program.GetOperands()) {
+            entry.namesSize += static_cast<uint32_t>(sizeof(uint32_t) + name.size());
+        }
+        size += entry.namesSize;
+
+        entry.sourceOffset = size;
+        entry.sourceLength = sources.empty() ? 0 : static_cast<uint32_t>(sources[i].size());
+        size += entry.sourceLength;
+    }
+
+    // A freshly sized file reads as zeros, which covers all padding.
+    TMappedFile out(path, size);
+    char* p = out.Data();
+
+    uint32_t instructionSize = sizeof(Instruction);
+    uint32_t programCount = static_cast<uint32_t>(programs.size());
+    uint64_t fileSize = size;
+    memcpy(p, kMagic, sizeof(kMagic));
+    memcpy(p + 8, &kVersion, sizeof(kVersion));
+    memcpy(p + 12, &kByteOrderMark, sizeof(kByteOrderMark));
+    memcpy(p + 16, &instructionSize, sizeof(instructionSize));
+    memcpy(p + 20, &programCount, sizeof(programCount));
+    memcpy(p + 24, &fileSize, sizeof(fileSize));
+    memcpy(p + kHeaderSize, entries.data(), entries.size() * sizeof(Entry));
+
+    for (size_t i = 0; i < programs.size(); i++) {
+        const TCompiledProgram& program = *programs[i];
+        const Entry& entry = entries[i];
+
+        // Field by field, so that the padding inside Instruction stays zero
+        // and equal programs give equal files.
+        char* code = p + entry.codeOffset;
+        for (size_t k = 0; k < program.GetInstructionCount(); k++) {
+            const Instruction& ins = program.GetInstructions()[k];
+            RawOpCode op = ins.op;
+            char* record = code + k * sizeof(Instruction);
+            memcpy(record + offsetof(Instruction, op), &op, sizeof(op));
+            memcpy(record + offsetof(Instruction, slot), &ins.slot, sizeof(ins.slot));
+            memcpy(record + offsetof(Instruction, value), &ins.value, sizeof(ins.value));
+        }
+
+        char* table = p + entry.namesOffset;
+        for (const pmr::string& name : program.GetOperands()) {
+            uint32_t length = static_cast<uint32_t>(name.size());
+            memcpy(table, &length, sizeof(length));
+            memcpy(table + sizeof(length), name.data(), name.size());
+            table += sizeof(length) + name.size();
+        }
+
+        if (entry.sourceLength) {
+            memcpy(p + entry.sourceOffset, sources[i].data(), entry.sourceLength);
+        }
+    }
+}
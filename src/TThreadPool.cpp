@@ -0,0 +1,152 @@
+#include "TThreadPool.h"
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+struct TThreadPool::Job {
+    const function<void(size_t, size_t)>* body;
+    size_t grain;
+    size_t remaining;
+    mutex lock;
+    condition_variable done;
+    exception_ptr error;
+};
+
+TThreadPool::TThreadPool(size_t threads, const vector<int>& cpus)
+    : queued(0), stopping(false) {
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        workers.push_back(unique_ptr<Worker>(new Worker));
+    }
+    for (size_t i = 0; i < threads; i++) {
+        workers[i]->handle = thread(&TThreadPool::Run, this, i);
+#if defined(__linux__)
+        if (!cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[i % cpus.size()], &set);
+            pthread_setaffinity_np(workers[i]->handle.native_handle(), sizeof(set), &set);
+        }
+#endif
+    }
+}
+
+TThreadPool::~TThreadPool() {
+    {
+        lock_guard<mutex> lk(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) {
+        w->handle.join();
+    }
+}
+
+void TThreadPool::Push(size_t self, const Task& task) {
+    {
+        lock_guard<mutex> lk(workers[self]->lock);
+        workers[self]->tasks.push_back(task);
+    }
+    queued++;
+    {
+        lock_guard<mutex> lk(sleepLock);
+    }
+    wake.notify_one();
+}
+
+bool TThreadPool::PopLocal(size_t self, Task& task) {
+    lock_guard<mutex> lk(workers[self]->lock);
+    if (workers[self]->tasks.empty()) {
+        return false;
+    }
+    task = workers[self]->tasks.back();
+    workers[self]->tasks.pop_back();
+    queued--;
+    return true;
+}
+
+bool TThreadPool::Steal(size_t self, Task& task) {
+    for (size_t k = 1; k < workers.size(); k++) {
+        Worker& victim = *workers[(self + k) % workers.size()];
+        lock_guard<mutex> lk(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TThreadPool::Execute(size_t self, Task task) {
+    Job& job = *task.job;
+
+    while (task.end - task.begin > job.grain) {
+        size_t mid = task.begin + (task.end - task.begin) / 2;
+        Push(self, Task{ mid, task.end, task.job });
+        task.end = mid;
+    }
+
+    exception_ptr error;
+    try {
+        (*job.body)(task.begin, task.end);
+    }
+    catch (...) {
+        error = current_exception();
+    }
+
+    // The waiting thread may destroy the job as soon as the lock is released.
+    lock_guard<mutex> lk(job.lock);
+    if (error && !job.error) {
+        job.error = error;
+    }
+    job.remaining -= task.end - task.begin;
+    if (job.remaining == 0) {
+        job.done.notify_all();
+    }
+}
+
+void TThreadPool::Run(size_t self) {
+    while (true) {
+        Task task;
+        if (PopLocal(self, task) || Steal(self, task)) {
+            Execute(self, task);
+            continue;
+        }
+
+        unique_lock<mutex> lk(sleepLock);
+        wake.wait(lk, [this] { return stopping || queued > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void TThreadPool::ParallelFor(size_t begin, size_t end, size_t grain, const function<void(size_t, size_t)>& body) {
+    if (begin >= end) {
+        return;
+    }
+
+    Job job;
+    job.body = &body;
+    job.grain = max<size_t>(grain, 1);
+    job.remaining = end - begin;
+
+    Push(0, Task{ begin, end, &job });
+
+    unique_lock<mutex> lk(job.lock);
+    job.done.wait(lk, [&job] { return job.remaining == 0; });
+
+    if (job.error) {
+        rethrow_exception(job.error);
+    }
+}
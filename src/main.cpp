@@ -1,13 +1,320 @@
 ﻿#include "TArithmeticExpression.h"
+#include "TBatchMode.h"
+#include "TDataset.h"
+#include "TExpressionGenerator.h"
+#include "TExpressionCache.h"
+#include "TInstrumentation.h"
+#include "TThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <string>
-#include <map>
+#include <vector>
 #include <iomanip> 
-#include <locale>
+#include <charconv>
 
-int main() {
-    std::setlocale(LC_ALL, "C");
-    std::locale::global(std::locale("C"));
+// Reads a whole line as one number, ignoring surrounding blanks. Unlike
+// std::stod this does not depend on the global locale.
+static bool ParseValue(const std::string& text, double& value) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    while (first < last && (*first == ' ' || *first == '\t')) {
+        first++;
+    }
+    while (last > first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')) {
+        last--;
+    }
+    if (last - first > 1 && first[0] == '+' && first[1] != '-') {
+        first++;
+    }
+    std::from_chars_result parsed = std::from_chars(first, last, value);
+    return parsed.ec == std::errc() && parsed.ptr == last && first < last;
+}
+
+// In an instrumented build the batch modes print the phase timings and
+// counters on stderr when they finish, and write a Chrome trace of the run to
+// the file named by CALC_TRACE, if set.
+class TInstrumentationReport {
+    const char* tracePath;
+
+public:
+    TInstrumentationReport() : tracePath(TInstrumentation::Enabled() ? std::getenv("CALC_TRACE") : nullptr) {
+        if (tracePath) {
+            TInstrumentation::StartTrace();
+        }
+    }
+
+    ~TInstrumentationReport() {
+        if (!TInstrumentation::Enabled()) {
+            return;
+        }
+        TInstrumentation::WriteText(std::cerr, TInstrumentation::Take());
+        if (tracePath) {
+            TInstrumentation::StopTrace();
+            std::ofstream trace(tracePath);
+            TInstrumentation::WriteTrace(trace);
+            if (!trace) {
+                std::cerr << "error: cannot write " << tracePath << std::endl;
+            }
+        }
+    }
+};
+
+// calc --batch [--threads N] [file]: evaluates one expression per line of the
+// file (or stdin) and reports the throughput on stderr.
+static int RunBatch(int argc, char* argv[]) {
+    TInstrumentationReport report;
+    const char* path = nullptr;
+    size_t threads = 0;
+    for (int i = 2; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!path) {
+            path = argv[i];
+        }
+        else {
+            std::cerr << "usage: calc --batch [--threads N] [file]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::ios::sync_with_stdio(false);
+    std::ifstream file;
+    if (path) {
+        file.open(path);
+        if (!file) {
+            std::cerr << "error: cannot open " << path << std::endl;
+            return 1;
+        }
+    }
+
+    TThreadPool pool(threads);
+    TBatchMode batch(TExpressionCache::Global(), pool);
+    auto start = std::chrono::steady_clock::now();
+    TBatchMode::Stats stats = batch.Run(path ? file : std::cin, std::cout);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << stats.lines << " lines, " << stats.errors << " errors, " << seconds << " s, "
+        << static_cast<size_t>(stats.lines / std::max(seconds, 1e-9)) << " lines/s" << std::endl;
+    return stats.errors ? 1 : 0;
+}
+
+// calc --eval <expression> <dataset> <output> [--threads N]: evaluates the
+// expression for every row of a CSV or columnar dataset into a columnar file.
+// calc --convert <dataset> <output> [--threads N]: rewrites a dataset as columnar.
+static int RunDataset(int argc, char* argv[]) {
+    TInstrumentationReport report;
+    bool convert = std::strcmp(argv[1], "--convert") == 0;
+    std::vector<const char*> args;
+    size_t threads = 0;
+    for (int i = 2; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.size() != (convert ? 2u : 3u)) {
+        std::cerr << "usage: calc --eval <expression> <dataset> <output> [--threads N]\n"
+            "       calc --convert <dataset> <output> [--threads N]" << std::endl;
+        return 2;
+    }
+
+    try {
+        TThreadPool pool(threads);
+        auto start = std::chrono::steady_clock::now();
+        TDataset data(args[convert ? 0 : 1]);
+        if (convert) {
+            data.WriteColumnar(args[1], pool);
+        }
+        else {
+            TArithmeticExpression expr(args[0]);
+            data.Evaluate(expr, args[2], pool);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << data.GetRows() << " rows, " << seconds << " s, "
+            << static_cast<size_t>(data.GetRows() / std::max(seconds, 1e-9)) << " rows/s" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+static void AppendNumber(std::string& out, double value) {
+    char buf[32];
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), value).ptr);
+}
+
+// calc --generate [options]: prints seeded random expressions, one per line,
+// and optionally a matching dataset. See GenerateUsage() for the options.
+static int GenerateUsage() {
+    std::cerr << "usage: calc --generate [options]\n"
+        "  --seed S          random seed (default 1)\n"
+        "  --count N         expressions to print (default 1)\n"
+        "  --tokens N        tokens per expression (default 64)\n"
+        "  --depth D         deepest parenthesis nesting (default 8)\n"
+        "  --variables V     distinct variables a, b, ... (default 4, at most 26)\n"
+        "  --literals P      share of leaves that are numbers (default 0.3)\n"
+        "  --trig P          share of operands that are sin/cos calls (default 0.1)\n"
+        "  --groups P        share of operands that are parenthesised (default 0.2)\n"
+        "  --ops A,S,M,D     relative weights of + - * / (default 1,1,1,1)\n"
+        "  --bindings        append '; a=..., b=...' to every line, for --batch\n"
+        "  --dataset FILE    also write --rows rows of variable values to FILE,\n"
+        "                    as CSV if FILE ends in .csv and columnar otherwise\n"
+        "  --rows N          dataset rows (default 1000000)" << std::endl;
+    return 2;
+}
+
+static int RunGenerate(int argc, char* argv[]) {
+    TExpressionGenerator::Options options;
+    size_t count = 1;
+    size_t rows = 1000000;
+    bool bindings = false;
+    const char* dataset = nullptr;
+
+    for (int i = 2; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--bindings") {
+            bindings = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return GenerateUsage();
+        }
+        std::string value = argv[++i];
+        double number = 0;
+        bool numeric = ParseValue(value, number) && number >= 0;
+        if (option == "--dataset") {
+            dataset = argv[i];
+        }
+        else if (option == "--ops") {
+            for (double& weight : options.operatorWeights) {
+                size_t comma = value.find(',');
+                if (!ParseValue(value.substr(0, comma), weight)) {
+                    return GenerateUsage();
+                }
+                value = comma == std::string::npos ? "" : value.substr(comma + 1);
+            }
+        }
+        else if (!numeric) {
+            return GenerateUsage();
+        }
+        else if (option == "--seed") {
+            options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (option == "--count") {
+            count = static_cast<size_t>(number);
+        }
+        else if (option == "--tokens") {
+            options.tokens = static_cast<size_t>(number);
+        }
+        else if (option == "--depth") {
+            options.maxDepth = static_cast<size_t>(number);
+        }
+        else if (option == "--variables") {
+            options.variables = static_cast<size_t>(number);
+        }
+        else if (option == "--literals") {
+            options.literalDensity = number;
+        }
+        else if (option == "--trig") {
+            options.trigFrequency = number;
+        }
+        else if (option == "--groups") {
+            options.groupFrequency = number;
+        }
+        else if (option == "--rows") {
+            rows = static_cast<size_t>(number);
+        }
+        else {
+            return GenerateUsage();
+        }
+    }
+
+    try {
+        std::ios::sync_with_stdio(false);
+        TExpressionGenerator generator(options);
+        std::vector<std::string> names = generator.GetVariables();
+        std::vector<std::vector<double>> values;
+        if (bindings) {
+            values = TExpressionGenerator::GenerateColumns(names.size(), count, options.seed);
+        }
+
+        std::string line;
+        for (size_t i = 0; i < count; i++) {
+            line = generator.Next();
+            for (size_t v = 0; bindings && v < names.size(); v++) {
+                line += v ? ", " : " ; ";
+                line += names[v] + "=";
+                AppendNumber(line, values[v][i]);
+            }
+            line += '\n';
+            std::cout.write(line.data(), line.size());
+        }
+        std::cout.flush();
+
+        if (dataset) {
+            std::vector<std::vector<double>> columns = TExpressionGenerator::GenerateColumns(names.size(), rows, options.seed);
+            std::string path = dataset;
+            if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0) {
+                std::ofstream file(path, std::ios::binary);
+                std::string text;
+                for (size_t v = 0; v < names.size(); v++) {
+                    text += (v ? "," : "") + names[v];
+                }
+                text += '\n';
+                for (size_t r = 0; r < rows && file; r++) {
+                    for (size_t v = 0; v < names.size(); v++) {
+                        if (v) {
+                            text += ',';
+                        }
+                        AppendNumber(text, columns[v][r]);
+                    }
+                    text += '\n';
+                    if (text.size() > (1 << 16)) {
+                        file.write(text.data(), text.size());
+                        text.clear();
+                    }
+                }
+                file.write(text.data(), text.size());
+                if (!file) {
+                    throw std::runtime_error("Cannot write " + path);
+                }
+            }
+            else {
+                std::vector<const double*> pointers;
+                for (const std::vector<double>& column : columns) {
+                    pointers.push_back(column.data());
+                }
+                TDataset::WriteColumnar(path, names, pointers.data(), rows);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--batch") == 0) {
+        return RunBatch(argc, argv);
+    }
+    if (argc > 1 && (std::strcmp(argv[1], "--eval") == 0 || std::strcmp(argv[1], "--convert") == 0)) {
+        return RunDataset(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--generate") == 0) {
+        return RunGenerate(argc, argv);
+    }
 
     std::cout << "Enter expression" << std::endl;
     std::cout << "\nType 'exit' to exit" << std::endl << std::endl;
@@ -26,10 +333,10 @@ int main() {
         }
 
         try {
-            TArithmeticExpression expr(input);
-            std::cout << "Reverse polish notation " << expr.GetPostfix() << std::endl;
+            auto expr = TExpressionCache::Global().Get(input);
+            std::cout << "Reverse polish notation " << expr->GetPostfix() << std::endl;
 
-            auto operands = expr.GetOperands();
+            auto operands = expr->GetOperands();
 
             if (!operands.empty()) {
                 std::cout << "\nVariables: ";
@@ -38,32 +345,32 @@ int main() {
                 }
                 std::cout << std::endl;
 
-                std::map<std::string, double> values;
+                std::vector<double> values(operands.size());
                 std::cout << "\nEnter variable values:" << std::endl;
 
-                for (const auto& op : operands) {
+                for (size_t i = 0; i < operands.size(); i++) {
+                    const std::string& op = operands[i];
                     bool valid = false;
                     while (!valid) {
                         std::cout << op << " = ";
                         std::string valStr;
                         std::getline(std::cin, valStr);
 
-                        try {
-                            double val = std::stod(valStr);
-                            values[op] = val;
+                        if (ParseValue(valStr, values[i])) {
                             valid = true;
                         }
-                        catch (...) {
+                        else {
                             std::cout << "Incorrect input. Please enter a number." << std::endl;
                         }
                     }
                 }
 
-                double result = expr.Calculate(values);
+                double result = expr->Calculate(values);
                 std::cout << "\nResult: " << std::fixed << std::setprecision(6) << result << std::endl;
             }
             else {
-                double result = expr.Calculate();
+                std::vector<double> values;
+                double result = expr->Calculate(values);
                 std::cout << "\nResult: " << std::fixed << std::setprecision(6) << result << std::endl;
             }
 
@@ -0,0 +1,205 @@
+#include <../gtest/gtest.h>
+#include "TArithmeticExpression.h"
+#include <cstdlib>
+#include <map>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+
+// Every global allocation of the test binary is counted per thread, so tests
+// can measure what a piece of code allocates without seeing other threads.
+namespace {
+
+thread_local size_t allocations = 0;
+
+void* CountedAlloc(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* CountedAlignedAlloc(size_t size, std::align_val_t align) {
+    allocations++;
+    size_t alignment = static_cast<size_t>(align);
+    void* p = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+size_t CountCompileAllocations(const std::string& infix, std::pmr::memory_resource* arena = nullptr) {
+    std::string copy = infix;
+    size_t before = allocations;
+    {
+        TArithmeticExpression expr(std::move(copy), arena);
+    }
+    return allocations - before;
+}
+
+template<typename F>
+size_t CountAllocations(F body) {
+    size_t before = allocations;
+    body();
+    return allocations - before;
+}
+
+std::string Sum(size_t terms) {
+    std::string infix = "a*1.5";
+    for (size_t i = 1; i < terms; i++) {
+        infix += " + (b - " + std::to_string(i) + ".25) / sin(c*" + std::to_string(i) + ")";
+    }
+    return infix;
+}
+
+std::string Nested(size_t depth) {
+    return std::string(depth, '(') + "a" + std::string(depth, ')') + " + b";
+}
+
+}
+
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void* operator new(size_t size, std::align_val_t align) { return CountedAlignedAlloc(size, align); }
+void* operator new[](size_t size, std::align_val_t align) { return CountedAlignedAlloc(size, align); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+
+TEST(CompileAllocationsTest, CountDoesNotGrowWithTokenCount) {
+    size_t small = CountCompileAllocations(Sum(2));
+    size_t large = CountCompileAllocations(Sum(2000));
+
+    // A fixed set of buffers: lexemes, the stack, postfix strings, the source
+    // and optimized programs, the optimizer's tables and the context.
+    EXPECT_LE(small, 20);
+    EXPECT_EQ(large, small);
+}
+
+TEST(CompileAllocationsTest, CountDoesNotGrowWithNesting) {
+    // Both sources are too long for the short-string buffer, so each copies
+    // its text into the expression once.
+    EXPECT_EQ(CountCompileAllocations(Nested(5000)), CountCompileAllocations(Nested(8)));
+}
+
+TEST(CompileAllocationsTest, ArenaServesTheWholeCompile) {
+    std::string infix = Sum(500);
+    // The arena cannot fall back to the heap, so any allocation outside it would throw.
+    std::vector<char> buffer(16 << 20);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+    EXPECT_EQ(CountCompileAllocations(infix, &arena), 0);
+    arena.release();
+
+    std::string copy = infix;
+    const double values[] = { 1.0, 2.0, 3.0 };
+    size_t before = allocations;
+    TArithmeticExpression expr(std::move(copy), &arena);
+    double result = expr.Calculate(values);
+    EXPECT_EQ(allocations - before, 0);
+
+    TArithmeticExpression reference(infix);
+    EXPECT_EQ(expr.GetPostfix(), reference.GetPostfix());
+    EXPECT_EQ(expr.GetOptimizedPostfix(), reference.GetOptimizedPostfix());
+    EXPECT_DOUBLE_EQ(result, reference.Calculate(values));
+}
+
+namespace {
+
+// Warms every single-row evaluation path up once, then checks that a
+// steady-state loop over it allocates nothing.
+void ExpectSteadyStateCalculateDoesNotAllocate(const std::string& infix) {
+    TArithmeticExpression expr(infix);
+    std::vector<std::string> names = expr.GetOperands();
+    std::vector<double> values(names.size(), 0.5);
+    std::map<std::string, double> named;
+    for (const std::string& name : names) {
+        named[name] = 0.5;
+    }
+    TEvaluationContext ctx(*expr.GetCompiledProgram());
+
+    expr.Calculate(named);
+    expr.Calculate(values.data());
+
+    volatile double sink = 0;
+    auto byName = [&] {
+        for (int i = 0; i < 1000; i++) {
+            named[names[0]] = i * 1e-3;
+            sink = sink + expr.Calculate(named);
+        }
+    };
+    EXPECT_EQ(CountAllocations(byName), 0) << infix;
+    auto bySlot = [&] {
+        for (int i = 0; i < 1000; i++) {
+            values[0] = i * 1e-3;
+            sink = sink + expr.Calculate(values.data()) + expr.Calculate(values);
+        }
+    };
+    EXPECT_EQ(CountAllocations(bySlot), 0) << infix;
+    auto byContext = [&] {
+        for (int i = 0; i < 1000; i++) {
+            ctx.SetValue(0, i * 1e-3);
+            sink = sink + expr.Calculate(ctx);
+        }
+    };
+    EXPECT_EQ(CountAllocations(byContext), 0) << infix;
+}
+
+}
+
+TEST(CalculateAllocationsTest, SteadyStateDoesNotAllocate) {
+    ExpectSteadyStateCalculateDoesNotAllocate("a + b*2");
+    ExpectSteadyStateCalculateDoesNotAllocate("sin(a)*cos(b) + sin(a)*cos(b) - a/(b + 1)");
+}
+
+TEST(CalculateAllocationsTest, DeepProgramsDoNotAllocateAfterWarmUp) {
+    // The stack is deeper than the on-stack buffer, so the context's scratch is used.
+    std::string infix = Nested(1);
+    for (int i = 0; i < 200; i++) {
+        infix = "a - (b + " + infix + ")";
+    }
+    TArithmeticExpression expr(infix);
+    ASSERT_GT(expr.GetStackDepth(), TCompiledProgram::kLocalScratch);
+
+    ExpectSteadyStateCalculateDoesNotAllocate(infix);
+}
+
+TEST(CalculateAllocationsTest, ContextBuiltForProgramDoesNotAllocate) {
+    std::string infix = "a";
+    for (int i = 0; i < 100; i++) {
+        infix = "a * (b + " + infix + ")";
+    }
+    TArithmeticExpression expr(infix);
+    TEvaluationContext ctx(*expr.GetCompiledProgram());
+
+    auto single = [&] {
+        ctx.SetValue(0, 0.5);
+        ctx.SetValue(1, 0.25);
+        volatile double result = expr.Calculate(ctx);
+        (void)result;
+    };
+    EXPECT_EQ(CountAllocations(single), 0);
+}
+
+TEST(CalculateAllocationsTest, BatchDoesNotAllocateAfterWarmUp) {
+    TArithmeticExpression expr("sin(a)*b + a/(b + 2)");
+    std::vector<double> a(1000, 0.5), b(1000, 1.5), out(1000);
+    const double* columns[] = { a.data(), b.data() };
+
+    expr.CalculateBatch(columns, out.data(), out.size());
+    auto batch = [&] {
+        for (int i = 0; i < 10; i++) {
+            expr.CalculateBatch(columns, out.data(), out.size());
+        }
+    };
+    EXPECT_EQ(CountAllocations(batch), 0);
+}
@@ -1,5 +1,6 @@
 ﻿#include <../gtest/gtest.h>
 #include "TArithmeticExpression.h"
+#include <clocale>
 #include <cmath>
 #include <map>
 
@@ -43,6 +44,48 @@ TEST(TArithmeticExpressionTest, FloatingPointNumbers) {
     EXPECT_NEAR(expr3.Calculate(), 2.5, 0.0001);
 }
 
+TEST(TArithmeticExpressionTest, ExponentNotation) {
+    TArithmeticExpression expr1("1.5e-3*2");
+    EXPECT_DOUBLE_EQ(expr1.Calculate(), 3e-3);
+    EXPECT_EQ(expr1.GetPostfix(), "1.5e-3 2 *");
+
+    TArithmeticExpression expr2("2E+2+1e2+5e0");
+    EXPECT_EQ(expr2.Calculate(), 305.0);
+
+    TArithmeticExpression expr3(".5e1-5.");
+    EXPECT_EQ(expr3.Calculate(), 0.0);
+
+    EXPECT_THROW(TArithmeticExpression("1e400"), std::invalid_argument);
+
+    // Without exponent digits the 'e' is a variable, as before.
+    TArithmeticExpression expr4("2e");
+    ASSERT_EQ(expr4.GetOperands().size(), 1);
+    EXPECT_EQ(expr4.GetOperands()[0], "e");
+}
+
+TEST(TArithmeticExpressionTest, LiteralsAreCorrectlyRounded) {
+    TArithmeticExpression expr1("0.1");
+    EXPECT_EQ(expr1.Calculate(), 0.1);
+
+    TArithmeticExpression expr2("2.2250738585072014e-308");
+    EXPECT_EQ(expr2.Calculate(), 2.2250738585072014e-308);
+
+    // Halfway between 1 and the next double: ties round to even.
+    TArithmeticExpression expr3("1.00000000000000011102230246251565404236316680908203125");
+    EXPECT_EQ(expr3.Calculate(), 1.0);
+}
+
+TEST(TArithmeticExpressionTest, LiteralsIgnoreGlobalLocale) {
+    const char* previous = std::setlocale(LC_NUMERIC, nullptr);
+    std::string saved = previous ? previous : "C";
+    if (!std::setlocale(LC_NUMERIC, "de_DE.UTF-8") && !std::setlocale(LC_NUMERIC, "ru_RU.UTF-8")) {
+        return; // no locale with a decimal comma is installed
+    }
+    TArithmeticExpression expr("2.5*2");
+    std::setlocale(LC_NUMERIC, saved.c_str());
+    EXPECT_EQ(expr.Calculate(), 5.0);
+}
+
 TEST(TArithmeticExpressionTest, ComplexExpressions) {
     TArithmeticExpression expr1("2+3*4");
     EXPECT_NEAR(expr1.Calculate(), 14.0, 0.0001);
@@ -242,4 +285,174 @@ TEST(TArithmeticExpressionTest, PiConstant) {
 
     TArithmeticExpression expr4("cos(pi)");
     EXPECT_NEAR(expr4.Calculate(), -1.0, 0.0001);
-}
\ No newline at end of file
+}
+
+TEST(TArithmeticExpressionTest, RepeatedEvaluationOfCompiledProgram) {
+    TArithmeticExpression expr("(a+1.5)*sin(b)-pi/c");
+    EXPECT_EQ(expr.GetPostfix(), "a 1.5 + b sin * pi c / -");
+
+    for (int i = 1; i <= 5; i++) {
+        std::map<std::string, double> values = { {"a", i}, {"b", 0.1 * i}, {"c", 2.0 * i} };
+        double expected = (i + 1.5) * sin(0.1 * i) - 3.141592653589793 / (2.0 * i);
+        EXPECT_NEAR(expr.Calculate(values), expected, 1e-12);
+    }
+}
+
+TEST(TArithmeticExpressionTest, MalformedProgramFailsOnEveryCalculate) {
+    TArithmeticExpression expr("2 3");
+    EXPECT_THROW(expr.Calculate(), std::runtime_error);
+    EXPECT_THROW(expr.Calculate(), std::runtime_error);
+
+    TArithmeticExpression expr2("2+");
+    EXPECT_THROW(expr2.Calculate(), std::runtime_error);
+}
+
+TEST(TArithmeticExpressionTest, OperandIndexMatchesGetOperands) {
+    TArithmeticExpression expr("c*a+b");
+    auto ops = expr.GetOperands();
+    ASSERT_EQ(ops.size(), 3);
+    for (size_t i = 0; i < ops.size(); i++) {
+        EXPECT_EQ(expr.GetOperandIndex(ops[i]), static_cast<int>(i));
+    }
+    EXPECT_EQ(expr.GetOperandIndex("x"), -1);
+    EXPECT_EQ(expr.GetOperandIndex("ab"), -1);
+}
+
+TEST(TArithmeticExpressionTest, CalculateWithSlotValues) {
+    TArithmeticExpression expr("c*a+b/2");
+    std::vector<double> values(expr.GetOperands().size());
+    values[expr.GetOperandIndex("a")] = 3;
+    values[expr.GetOperandIndex("b")] = 4;
+    values[expr.GetOperandIndex("c")] = 5;
+
+    EXPECT_NEAR(expr.Calculate(values.data()), 17.0, 0.0001);
+    EXPECT_NEAR(expr.Calculate(values), 17.0, 0.0001);
+
+    std::map<std::string, double> named = { {"a", 3}, {"b", 4}, {"c", 5} };
+    EXPECT_NEAR(expr.Calculate(named), expr.Calculate(values), 0.0001);
+
+    EXPECT_THROW(expr.Calculate(std::vector<double>(2)), std::invalid_argument);
+}
+
+TEST(TArithmeticExpressionTest, BatchMatchesRowByRow) {
+    const char* formulas[] = { "(a+b)*c-sin(a)/2+b*b", "x", "cos(y)*3-x", "2+3*4", "a/(b+1)-a*a",
+        "sin(a+b)*cos(a+b)+(b+a)" };
+    const size_t rows = 1000;
+
+    for (const char* formula : formulas) {
+        TArithmeticExpression expr(formula);
+        size_t vars = expr.GetOperands().size();
+
+        std::vector<std::vector<double>> data(vars, std::vector<double>(rows));
+        std::vector<const double*> columns(vars);
+        for (size_t v = 0; v < vars; v++) {
+            for (size_t r = 0; r < rows; r++) {
+                data[v][r] = 0.25 * r + v + 1;
+            }
+            columns[v] = data[v].data();
+        }
+
+        std::vector<double> out(rows);
+        expr.CalculateBatch(columns.data(), out.data(), rows);
+
+        std::vector<double> row(vars);
+        for (size_t r = 0; r < rows; r++) {
+            for (size_t v = 0; v < vars; v++) {
+                row[v] = data[v][r];
+            }
+            // sin/cos may come from the SIMD kernels, which are a few ULP off libm.
+            double expected = expr.Calculate(row.data());
+            EXPECT_NEAR(out[r], expected, 1e-13 * std::max(1.0, std::fabs(expected))) << formula << " row " << r;
+        }
+    }
+}
+
+TEST(TArithmeticExpressionTest, BatchErrors) {
+    TArithmeticExpression expr("a/b");
+    std::vector<double> a(10, 1.0), b(10, 2.0), out(10);
+    b[7] = 0;
+    const double* columns[] = { a.data(), b.data() };
+    EXPECT_THROW(expr.CalculateBatch(columns, out.data(), 10), std::runtime_error);
+
+    TArithmeticExpression bad("sin");
+    EXPECT_THROW(bad.CalculateBatch(nullptr, out.data(), 10), std::runtime_error);
+}
+
+TEST(TArithmeticExpressionTest, ConstantFolding) {
+    TArithmeticExpression expr1("(3.5+4.5)*2");
+    EXPECT_EQ(expr1.GetPostfix(), "3.5 4.5 + 2 *");
+    EXPECT_EQ(expr1.GetOptimizedPostfix(), "16");
+    EXPECT_EQ(expr1.GetEliminatedOperations(), 2);
+    EXPECT_EQ(expr1.Calculate(), 16.0);
+
+    TArithmeticExpression expr2("x*(2*pi/360)");
+    EXPECT_EQ(expr2.GetEliminatedOperations(), 2);
+    EXPECT_EQ(expr2.GetProgram().size(), 3);
+    std::map<std::string, double> values = { {"x", 90} };
+    EXPECT_EQ(expr2.Calculate(values), 90 * (2 * 3.141592653589793 / 360));
+
+    TArithmeticExpression expr3("sin(pi/6)+a");
+    EXPECT_EQ(expr3.GetEliminatedOperations(), 2);
+    EXPECT_EQ(expr3.GetProgram().size(), 3);
+    EXPECT_EQ(expr3.Calculate(), sin(3.141592653589793 / 6));
+
+    TArithmeticExpression expr4("a+b");
+    EXPECT_EQ(expr4.GetOptimizedPostfix(), "a b +");
+    EXPECT_EQ(expr4.GetEliminatedOperations(), 0);
+}
+
+TEST(TArithmeticExpressionTest, OnlyExactIdentitiesAreApplied) {
+    TArithmeticExpression expr1("x*1 + 1*y - z/1 - (w-0)");
+    EXPECT_EQ(expr1.GetOptimizedPostfix(), "x y + z - w -");
+    EXPECT_EQ(expr1.GetEliminatedOperations(), 4);
+
+    // x+0 turns -0 into +0, x-x is NaN for infinities: both must stay.
+    TArithmeticExpression expr2("x+0");
+    EXPECT_EQ(expr2.GetOptimizedPostfix(), "x 0 +");
+    std::map<std::string, double> negZero = { {"x", -0.0} };
+    EXPECT_FALSE(std::signbit(expr2.Calculate(negZero)));
+
+    TArithmeticExpression expr3("x-x");
+    EXPECT_EQ(expr3.GetOptimizedPostfix(), "x x -");
+
+    TArithmeticExpression expr4("0*x");
+    EXPECT_EQ(expr4.GetOptimizedPostfix(), "0 x *");
+}
+
+TEST(TArithmeticExpressionTest, DivisionByLiteralZeroIsNotFolded) {
+    TArithmeticExpression expr("1+5/(2-2)");
+    EXPECT_EQ(expr.GetOptimizedPostfix(), "1 5 0 / +");
+    EXPECT_THROW(expr.Calculate(), std::runtime_error);
+}
+
+TEST(TArithmeticExpressionTest, CommonSubexpressionsAreComputedOnce) {
+    TArithmeticExpression expr1("sin(a+b)*cos(a+b)");
+    EXPECT_EQ(expr1.GetDeduplicatedNodes(), 1);
+    EXPECT_EQ(expr1.GetOptimizedPostfix(), "a b + =t0 sin t0 cos *");
+    EXPECT_EQ(expr1.GetTempCount(), 1);
+
+    TArithmeticExpression expr2("(a+b)*(b+a) + (a*b - b*a)");
+    EXPECT_EQ(expr2.GetDeduplicatedNodes(), 2);
+
+    TArithmeticExpression expr3("(x+1)*(x+1)*(x+1)");
+    EXPECT_EQ(expr3.GetDeduplicatedNodes(), 2);
+    EXPECT_EQ(expr3.GetOptimizedPostfix(), "x 1 + =t0 t0 * t0 *");
+
+    // Subtraction and division are not commutative.
+    TArithmeticExpression expr4("(a-b)*(b-a)+(a/b)*(b/a)");
+    EXPECT_EQ(expr4.GetDeduplicatedNodes(), 0);
+    EXPECT_EQ(expr4.GetTempCount(), 0);
+
+    for (double x = -2; x <= 2; x += 0.25) {
+        std::map<std::string, double> values = { {"a", x}, {"b", 1 - x}, {"x", x} };
+        EXPECT_EQ(expr1.Calculate(values), sin(x + (1 - x)) * cos(x + (1 - x)));
+        EXPECT_EQ(expr3.Calculate(values), (x + 1) * (x + 1) * (x + 1));
+    }
+}
+
+TEST(TArithmeticExpressionTest, SharedSubexpressionKeepsDivisionCheck) {
+    TArithmeticExpression expr("1/(a-b) + 2/(a-b)");
+    EXPECT_EQ(expr.GetDeduplicatedNodes(), 1);
+    std::map<std::string, double> values = { {"a", 3}, {"b", 3} };
+    EXPECT_THROW(expr.Calculate(values), std::runtime_error);
+}
@@ -0,0 +1,131 @@
+#include <../gtest/gtest.h>
+#include "TBatchKernels.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+int64_t UlpDistance(double a, double b) {
+    if (std::isnan(a) || std::isnan(b)) {
+        return std::isnan(a) && std::isnan(b) ? 0 : std::numeric_limits<int64_t>::max();
+    }
+    int64_t ia, ib;
+    std::memcpy(&ia, &a, sizeof(a));
+    std::memcpy(&ib, &b, sizeof(b));
+    if (ia < 0) ia = std::numeric_limits<int64_t>::min() - ia;
+    if (ib < 0) ib = std::numeric_limits<int64_t>::min() - ib;
+    return ia > ib ? ia - ib : ib - ia;
+}
+
+std::vector<const TBatchKernels*> AvailableKernels() {
+    std::vector<const TBatchKernels*> kernels;
+    const TBatchKernels::Isa all[] = { TBatchKernels::SCALAR, TBatchKernels::SSE2, TBatchKernels::AVX2, TBatchKernels::AVX512 };
+    for (TBatchKernels::Isa isa : all) {
+        if (const TBatchKernels* k = TBatchKernels::Get(isa)) {
+            kernels.push_back(k);
+        }
+    }
+    return kernels;
+}
+
+std::vector<double> TrigInputs() {
+    std::vector<double> x;
+    std::mt19937_64 gen(42);
+    const double ranges[] = { 1.0, 10.0, 1000.0, TBatchKernels::kSinCosFastLimit };
+    for (double range : ranges) {
+        std::uniform_real_distribution<double> dist(-range, range);
+        for (int i = 0; i < 200000; i++) {
+            x.push_back(dist(gen));
+        }
+    }
+    // Arguments next to multiples of pi/2 stress the range reduction.
+    for (int i = -500; i <= 500; i++) {
+        double m = i * 1.57079632679489661923;
+        x.push_back(m);
+        x.push_back(std::nextafter(m, 0.0));
+        x.push_back(std::nextafter(m, 1e300));
+    }
+    const double special[] = { 0.0, -0.0, 1e-300, -1e-300, 1e6, -3e10, 1e300,
+        std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN() };
+    x.insert(x.end(), std::begin(special), std::end(special));
+    return x;
+}
+
+}
+
+TEST(TBatchKernelsTest, ScalarAndBestAreAlwaysAvailable) {
+    ASSERT_NE(TBatchKernels::Get(TBatchKernels::SCALAR), nullptr);
+    EXPECT_NE(TBatchKernels::Best().name, nullptr);
+}
+
+TEST(TBatchKernelsTest, ArithmeticIsBitIdenticalToScalar) {
+    std::mt19937_64 gen(7);
+    std::uniform_real_distribution<double> dist(-1e3, 1e3);
+    const size_t n = 1003;
+    std::vector<double> a(n), b(n), expected(n), got(n);
+    for (size_t i = 0; i < n; i++) {
+        a[i] = dist(gen);
+        b[i] = dist(gen);
+    }
+
+    for (const TBatchKernels* k : AvailableKernels()) {
+        k->add(got.data(), a.data(), b.data(), n);
+        for (size_t i = 0; i < n; i++) EXPECT_EQ(got[i], a[i] + b[i]) << k->name;
+        k->sub(got.data(), a.data(), b.data(), n);
+        for (size_t i = 0; i < n; i++) EXPECT_EQ(got[i], a[i] - b[i]) << k->name;
+        k->mul(got.data(), a.data(), b.data(), n);
+        for (size_t i = 0; i < n; i++) EXPECT_EQ(got[i], a[i] * b[i]) << k->name;
+        EXPECT_TRUE(k->div(got.data(), a.data(), b.data(), n));
+        for (size_t i = 0; i < n; i++) EXPECT_EQ(got[i], a[i] / b[i]) << k->name;
+
+        // In place, as CalculateBatch uses them.
+        expected = a;
+        k->add(expected.data(), expected.data(), b.data(), n);
+        for (size_t i = 0; i < n; i++) EXPECT_EQ(expected[i], a[i] + b[i]) << k->name;
+    }
+}
+
+TEST(TBatchKernelsTest, DivisionReportsZeroDivisor) {
+    for (const TBatchKernels* k : AvailableKernels()) {
+        for (size_t zeroAt = 0; zeroAt < 19; zeroAt++) {
+            std::vector<double> a(19, 1.0), b(19, 2.0), out(19);
+            b[zeroAt] = -0.0;
+            EXPECT_FALSE(k->div(out.data(), a.data(), b.data(), b.size())) << k->name << " at " << zeroAt;
+        }
+    }
+}
+
+TEST(TBatchKernelsTest, SinCosWithinUlpBound) {
+    std::vector<double> x = TrigInputs();
+    std::vector<double> s(x.size()), c(x.size());
+
+    for (const TBatchKernels* k : AvailableKernels()) {
+        k->sin(s.data(), x.data(), x.size());
+        k->cos(c.data(), x.data(), x.size());
+
+        int64_t worstSin = 0, worstCos = 0;
+        for (size_t i = 0; i < x.size(); i++) {
+            worstSin = std::max(worstSin, UlpDistance(s[i], std::sin(x[i])));
+            worstCos = std::max(worstCos, UlpDistance(c[i], std::cos(x[i])));
+        }
+        EXPECT_LE(worstSin, TBatchKernels::kSinCosMaxUlp) << k->name;
+        EXPECT_LE(worstCos, TBatchKernels::kSinCosMaxUlp) << k->name;
+    }
+}
+
+TEST(TBatchKernelsTest, SinKeepsSignOfZeroAndHandlesTails) {
+    for (const TBatchKernels* k : AvailableKernels()) {
+        for (size_t n = 0; n <= 17; n++) {
+            std::vector<double> x(n, -0.0), out(n, 1.0);
+            k->sin(out.data(), x.data(), n);
+            for (size_t i = 0; i < n; i++) {
+                EXPECT_EQ(out[i], 0.0) << k->name;
+                EXPECT_TRUE(std::signbit(out[i])) << k->name;
+            }
+        }
+    }
+}
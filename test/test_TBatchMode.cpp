@@ -0,0 +1,100 @@
+#include <../gtest/gtest.h>
+#include "TBatchMode.h"
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string Evaluate(const std::string& line) {
+    TExpressionCache cache;
+    std::string out;
+    TBatchMode::EvaluateLine(line, cache, out);
+    return out;
+}
+
+}
+
+TEST(TBatchModeTest, EvaluatesLinesWithBindings) {
+    EXPECT_EQ(Evaluate("2+3"), "5\n");
+    EXPECT_EQ(Evaluate("(a+b)*c ; a=1, b=2, c=0.5"), "1.5\n");
+    EXPECT_EQ(Evaluate("a-b;b=1 a=4 unused=7"), "3\n");
+    EXPECT_EQ(Evaluate("x*2 ; x=1.5e-3\r"), "0.003\n");
+    EXPECT_EQ(Evaluate("0.1+0.2"), "0.30000000000000004\n");
+    EXPECT_EQ(Evaluate("   "), "\n");
+}
+
+TEST(TBatchModeTest, UnboundVariablesAreZero) {
+    EXPECT_EQ(Evaluate("a+b ; a=1"), "1\n");
+    EXPECT_EQ(Evaluate("cos(x)"), "1\n");
+}
+
+TEST(TBatchModeTest, ErrorsAreReportedPerLine) {
+    TExpressionCache cache;
+    std::string out;
+    EXPECT_FALSE(TBatchMode::EvaluateLine("2$3", cache, out));
+    EXPECT_FALSE(TBatchMode::EvaluateLine("a ; a=x", cache, out));
+    EXPECT_FALSE(TBatchMode::EvaluateLine("a ; a", cache, out));
+    EXPECT_FALSE(TBatchMode::EvaluateLine(" ; a=1", cache, out));
+    EXPECT_FALSE(TBatchMode::EvaluateLine("1/0", cache, out));
+
+    std::istringstream lines(out);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(lines, line)) {
+        EXPECT_EQ(line.compare(0, 7, "error: "), 0) << line;
+        count++;
+    }
+    EXPECT_EQ(count, 5);
+}
+
+TEST(TBatchModeTest, OutputKeepsInputOrder) {
+    std::ostringstream input, expected;
+    for (int i = 0; i < 5000; i++) {
+        if (i % 97 == 0) {
+            input << "2$" << i << "\n";
+            expected << "error: \n";
+        }
+        else {
+            input << "x*2+" << i % 13 << " ; x=" << i << "\n";
+            expected << i * 2 + i % 13 << "\n";
+        }
+    }
+
+    TExpressionCache cache;
+    TThreadPool pool(4);
+    TBatchMode batch(cache, pool, 1000);
+    std::istringstream in(input.str());
+    std::ostringstream out;
+    TBatchMode::Stats stats = batch.Run(in, out);
+
+    EXPECT_EQ(stats.lines, 5000);
+    EXPECT_EQ(stats.errors, 52);
+
+    // Compare line by line, error lines by prefix only.
+    std::istringstream got(out.str()), want(expected.str());
+    std::string a, b;
+    size_t lines = 0;
+    while (std::getline(want, b)) {
+        ASSERT_TRUE(static_cast<bool>(std::getline(got, a))) << "missing line " << lines;
+        if (b == "error: ") {
+            EXPECT_EQ(a.compare(0, 7, "error: "), 0) << "line " << lines;
+        }
+        else {
+            EXPECT_EQ(a, b) << "line " << lines;
+        }
+        lines++;
+    }
+    EXPECT_FALSE(static_cast<bool>(std::getline(got, a)));
+}
+
+TEST(TBatchModeTest, LastLineWithoutNewline) {
+    TExpressionCache cache;
+    TThreadPool pool(2);
+    TBatchMode batch(cache, pool);
+    std::istringstream in("1+1\n\n2*3");
+    std::ostringstream out;
+    TBatchMode::Stats stats = batch.Run(in, out);
+    EXPECT_EQ(stats.lines, 3);
+    EXPECT_EQ(stats.errors, 0);
+    EXPECT_EQ(out.str(), "2\n\n6\n");
+}
@@ -0,0 +1,80 @@
+#include <../gtest/gtest.h>
+#include "TCompiledProgram.h"
+#include "TArithmeticExpression.h"
+#include <cmath>
+#include <thread>
+#include <vector>
+
+TEST(TCompiledProgramTest, ValidatesStackDepthAndSlots) {
+    std::pmr::vector<std::pmr::string> names = { "x" };
+    TCompiledProgram ok({ Instruction(Instruction::PUSH_OPERAND, 0), Instruction(Instruction::PUSH_NUMBER, 0, 2),
+        Instruction(Instruction::MUL) }, names);
+    EXPECT_TRUE(ok.GetError().empty());
+    EXPECT_EQ(ok.GetStackDepth(), 2);
+
+    TCompiledProgram underflow({ Instruction(Instruction::PUSH_NUMBER, 0, 2), Instruction(Instruction::ADD) }, names);
+    EXPECT_FALSE(underflow.GetError().empty());
+
+    TCompiledProgram badSlot({ Instruction(Instruction::PUSH_OPERAND, 1) }, names);
+    EXPECT_FALSE(badSlot.GetError().empty());
+
+    TCompiledProgram badTemp({ Instruction(Instruction::LOAD_TEMP, 0) }, names);
+    EXPECT_FALSE(badTemp.GetError().empty());
+
+    TEvaluationContext ctx(underflow);
+    EXPECT_THROW(underflow.Evaluate(ctx), std::runtime_error);
+}
+
+TEST(TCompiledProgramTest, EvaluatesWithContext) {
+    TArithmeticExpression expr("x*y+sin(x)");
+    std::shared_ptr<const TCompiledProgram> program = expr.GetCompiledProgram();
+
+    TEvaluationContext ctx(*program);
+    ctx.SetValue(program->GetOperandIndex("x"), 2);
+    ctx.SetValue(program->GetOperandIndex("y"), 3);
+    EXPECT_EQ(program->Evaluate(ctx), 2 * 3 + sin(2.0));
+    EXPECT_EQ(expr.Calculate(ctx), 2 * 3 + sin(2.0));
+    EXPECT_EQ(ctx.GetValue(program->GetOperandIndex("y")), 3);
+}
+
+TEST(TCompiledProgramTest, CopiesShareTheProgram) {
+    TArithmeticExpression expr("a+b");
+    TArithmeticExpression copy = expr;
+    EXPECT_EQ(copy.GetCompiledProgram(), expr.GetCompiledProgram());
+
+    // Named values stay per object.
+    std::map<std::string, double> values = { {"a", 1}, {"b", 2} };
+    EXPECT_EQ(expr.Calculate(values), 3);
+    EXPECT_EQ(copy.Calculate(), 0);
+}
+
+TEST(TCompiledProgramTest, ConcurrentEvaluationOfOneExpression) {
+    const TArithmeticExpression expr("(a+b)*(a-b)/(b+1)+cos(a*b)");
+    const int threads = 4;
+    const int iterations = 20000;
+    std::vector<int> mismatches(threads, 0);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            TEvaluationContext ctx(*expr.GetCompiledProgram());
+            for (int i = 0; i < iterations; i++) {
+                double a = t + i * 1e-3, b = i * 2e-3;
+                ctx.SetValue(0, a);
+                ctx.SetValue(1, b);
+                double expected = (a + b) * (a - b) / (b + 1) + cos(a * b);
+                double values[] = { a, b };
+                if (expr.Calculate(ctx) != expected || expr.Calculate(values) != expected) {
+                    mismatches[t]++;
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    for (int t = 0; t < threads; t++) {
+        EXPECT_EQ(mismatches[t], 0) << "thread " << t;
+    }
+}
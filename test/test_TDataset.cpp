@@ -0,0 +1,140 @@
+#include <../gtest/gtest.h>
+#include "TDataset.h"
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string TempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("calc_test_" + name)).string();
+}
+
+void WriteText(const std::string& path, const std::string& text) {
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+std::vector<double> ReadResult(const std::string& path) {
+    TDataset result(path);
+    EXPECT_TRUE(result.IsColumnar());
+    EXPECT_EQ(result.GetColumnNames(), std::vector<std::string>(1, "result"));
+    const double* values = result.GetColumn(0);
+    return std::vector<double>(values, values + result.GetRows());
+}
+
+}
+
+TEST(TDatasetTest, EvaluatesCsvByColumnName) {
+    std::string csv = TempPath("names.csv");
+    WriteText(csv, "b, unused ,a\r\n1,100,2\r\n\r\n 3 ,0, 4.5e1\n-1,7,+0.5");
+
+    TDataset data(csv);
+    EXPECT_FALSE(data.IsColumnar());
+    EXPECT_EQ(data.GetRows(), 3);
+    EXPECT_EQ(data.GetColumnNames(), (std::vector<std::string>{ "b", "unused", "a" }));
+
+    TArithmeticExpression expr("a-b");
+    std::vector<double> out(3);
+    TThreadPool pool(2);
+    data.Evaluate(expr, out.data(), pool);
+    EXPECT_EQ(out, (std::vector<double>{ 1, 42, 1.5 }));
+    std::remove(csv.c_str());
+}
+
+TEST(TDatasetTest, CsvAndColumnarAgreeAcrossBlocks) {
+    const size_t rows = TDataset::kBlockRows * 3 + 17;
+    std::string csv = TempPath("blocks.csv");
+    std::string cols = TempPath("blocks.cols");
+    std::string fromCsv = TempPath("blocks_csv.out");
+    std::string fromCols = TempPath("blocks_cols.out");
+    {
+        std::ofstream file(csv);
+        file << "x,y\n";
+        for (size_t i = 0; i < rows; i++) {
+            file << i << "," << i * 0.25 << "\n";
+        }
+    }
+
+    TThreadPool pool(4);
+    TDataset(csv).WriteColumnar(cols, pool);
+    TDataset columnar(cols);
+    ASSERT_TRUE(columnar.IsColumnar());
+    ASSERT_EQ(columnar.GetRows(), rows);
+
+    TArithmeticExpression expr("x*y+sin(x)");
+    TDataset(csv).Evaluate(expr, fromCsv, pool);
+    columnar.Evaluate(expr, fromCols, pool);
+
+    std::vector<double> a = ReadResult(fromCsv);
+    std::vector<double> b = ReadResult(fromCols);
+    ASSERT_EQ(a.size(), rows);
+    EXPECT_EQ(a, b);
+    for (size_t i = 0; i < rows; i += 997) {
+        EXPECT_NEAR(a[i], i * (i * 0.25) + std::sin(double(i)), 1e-9 * std::max(1.0, a[i])) << i;
+    }
+    for (const std::string& path : { csv, cols, fromCsv, fromCols }) {
+        std::remove(path.c_str());
+    }
+}
+
+TEST(TDatasetTest, ColumnarRoundTrip) {
+    std::string path = TempPath("roundtrip.cols");
+    double p[] = { 1, 2, 3 };
+    double q[] = { 10, 20, 30 };
+    const double* columns[] = { p, q };
+    TDataset::WriteColumnar(path, { "p", "q" }, columns, 3);
+
+    TDataset data(path);
+    EXPECT_EQ(data.GetRows(), 3);
+    EXPECT_EQ(data.GetColumnIndex("q"), 1);
+    EXPECT_EQ(data.GetColumnIndex("z"), -1);
+    EXPECT_EQ(data.GetColumn(1)[2], 30);
+
+    TArithmeticExpression expr("q/p");
+    std::vector<double> out(3);
+    TThreadPool pool(1);
+    data.Evaluate(expr, out.data(), pool);
+    EXPECT_EQ(out, (std::vector<double>{ 10, 10, 10 }));
+    std::remove(path.c_str());
+}
+
+TEST(TDatasetTest, Errors) {
+    std::string path = TempPath("errors");
+    TThreadPool pool(1);
+    std::vector<double> out(2);
+
+    EXPECT_THROW(TDataset("/nonexistent/calc.csv"), std::runtime_error);
+
+    WriteText(path, "a,b\n1,2\n3\n");
+    TArithmeticExpression sum("a+b");
+    EXPECT_THROW(TDataset(path).Evaluate(sum, out.data(), pool), std::runtime_error);
+
+    WriteText(path, "a,b\n1,2\n3,x\n");
+    EXPECT_THROW(TDataset(path).Evaluate(sum, out.data(), pool), std::runtime_error);
+
+    WriteText(path, "a,,b\n");
+    EXPECT_THROW(TDataset data(path), std::runtime_error);
+
+    WriteText(path, "a\n1\n2\n");
+    TArithmeticExpression missing("a+c");
+    EXPECT_THROW(TDataset(path).Evaluate(missing, out.data(), pool), std::invalid_argument);
+
+    // Columnar header claiming more rows than the file holds.
+    double values[] = { 1, 2 };
+    const double* columns[] = { values };
+    TDataset::WriteColumnar(path, { "a" }, columns, 2);
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        uint64_t rows = 1000;
+        file.seekp(16);
+        file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+    }
+    EXPECT_THROW(TDataset data(path), std::runtime_error);
+
+    WriteText(path, std::string("CALCCOLS\1\0\0\0", 12));
+    EXPECT_THROW(TDataset data(path), std::runtime_error);
+    std::remove(path.c_str());
+}
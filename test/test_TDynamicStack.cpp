@@ -1,5 +1,10 @@
 #include <../gtest/gtest.h>
 #include "TDynamicStack.h"
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 TEST(TDynamicStackTest, ConstructorAndSize) {
     TDynamicStack<int> stack;
@@ -80,4 +85,228 @@ TEST(TDynamicStackTest, ComplexTypes) {
     EXPECT_EQ(stack.Top(), v2);
     stack.Pop();
     EXPECT_EQ(stack.Top(), v1);
-}
\ No newline at end of file
+}
+
+namespace {
+
+// Counts live objects, so tests can check that every constructed element is
+// destroyed exactly once and that spare capacity holds no objects.
+struct Tracked {
+    static int alive;
+    int value;
+
+    Tracked(int v = 0) : value(v) { alive++; }
+    Tracked(const Tracked& other) : value(other.value) { alive++; }
+    Tracked(Tracked&& other) noexcept : value(other.value) { other.value = -1; alive++; }
+    Tracked& operator=(const Tracked&) = default;
+    ~Tracked() { alive--; }
+};
+
+int Tracked::alive = 0;
+
+}
+
+TEST(TDynamicStackTest, InlineCapacity) {
+    TDynamicStack<int, 8> stack;
+    EXPECT_EQ(stack.capacity(), 8);
+
+    for (int i = 0; i < 8; i++) {
+        stack.Push(i);
+    }
+    EXPECT_TRUE(stack.IsFull());
+
+    stack.Push(8);
+    EXPECT_GT(stack.capacity(), 8);
+    for (int i = 8; i >= 0; i--) {
+        EXPECT_EQ(stack.Pop(), i);
+    }
+}
+
+TEST(TDynamicStackTest, ReserveDoesNotConstructElements) {
+    {
+        TDynamicStack<Tracked, 2> stack(100);
+        EXPECT_EQ(stack.capacity(), 100);
+        EXPECT_EQ(Tracked::alive, 0);
+
+        stack.Emplace(1);
+        stack.Push(Tracked(2));
+        stack.reserve(1000);
+        EXPECT_EQ(stack.capacity(), 1000);
+        EXPECT_EQ(Tracked::alive, 2);
+        EXPECT_EQ(stack.Top().value, 2);
+    }
+    EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(TDynamicStackTest, EveryElementIsDestroyedOnce) {
+    {
+        TDynamicStack<Tracked, 4> stack;
+        for (int i = 0; i < 100; i++) {
+            stack.Emplace(i);
+        }
+        EXPECT_EQ(Tracked::alive, 100);
+        for (int i = 0; i < 50; i++) {
+            stack.Pop();
+        }
+        EXPECT_EQ(Tracked::alive, 50);
+        stack.clear();
+        EXPECT_EQ(Tracked::alive, 0);
+        stack.Emplace(7);
+    }
+    EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(TDynamicStackTest, MoveOnlyElements) {
+    TDynamicStack<std::unique_ptr<int>> stack;
+    for (int i = 0; i < 10; i++) {
+        stack.Push(std::make_unique<int>(i));
+    }
+    stack.Emplace(new int(10));
+
+    EXPECT_EQ(*stack.Top(), 10);
+    std::unique_ptr<int> top = stack.Pop();
+    EXPECT_EQ(*top, 10);
+    EXPECT_EQ(*stack.PopUnchecked(), 9);
+    EXPECT_EQ(*stack.TopUnchecked(), 8);
+}
+
+TEST(TDynamicStackTest, PushOfOwnElementWhileGrowing) {
+    TDynamicStack<std::string, 1> stack;
+    stack.Push("a long string that does not fit in the small string buffer");
+    EXPECT_TRUE(stack.IsFull());
+
+    stack.Push(stack.Top());
+    EXPECT_EQ(stack.Pop(), "a long string that does not fit in the small string buffer");
+    EXPECT_EQ(stack.Pop(), "a long string that does not fit in the small string buffer");
+}
+
+TEST(TDynamicStackTest, CopyIsIndependent) {
+    TDynamicStack<std::string, 2> stack;
+    for (int i = 0; i < 5; i++) {
+        stack.Push(std::to_string(i));
+    }
+
+    TDynamicStack<std::string, 2> copy(stack);
+    EXPECT_EQ(copy.size(), 5);
+    copy.Pop();
+    copy.Push("x");
+    EXPECT_EQ(stack.Top(), "4");
+    EXPECT_EQ(copy.Top(), "x");
+
+    TDynamicStack<std::string, 2> assigned;
+    assigned.Push("y");
+    assigned = stack;
+    EXPECT_EQ(assigned.size(), 5);
+    EXPECT_EQ(assigned.Pop(), "4");
+
+    assigned = assigned;
+    EXPECT_EQ(assigned.size(), 4);
+}
+
+TEST(TDynamicStackTest, MoveFromInlineAndHeapStorage) {
+    TDynamicStack<std::string, 4> small;
+    small.Push("a");
+    small.Push("b");
+    TDynamicStack<std::string, 4> fromSmall(std::move(small));
+    EXPECT_TRUE(small.IsEmpty());
+    EXPECT_EQ(fromSmall.size(), 2);
+    EXPECT_EQ(fromSmall.Pop(), "b");
+
+    TDynamicStack<std::string, 4> large;
+    for (int i = 0; i < 10; i++) {
+        large.Push(std::to_string(i));
+    }
+    TDynamicStack<std::string, 4> fromLarge;
+    fromLarge.Push("z");
+    fromLarge = std::move(large);
+    EXPECT_TRUE(large.IsEmpty());
+    EXPECT_EQ(large.capacity(), 4);
+    EXPECT_EQ(fromLarge.size(), 10);
+    EXPECT_EQ(fromLarge.Pop(), "9");
+
+    large.Push("reused");
+    EXPECT_EQ(large.Top(), "reused");
+}
+
+// Containers of stacks move them on growth only if the move constructor
+// cannot throw. Move assignment between different memory resources
+// allocates, so it is allowed to.
+TEST(TDynamicStackTest, MoveConstructionIsNoexcept) {
+    typedef TDynamicStack<std::string, 4> Stack;
+    EXPECT_TRUE(std::is_nothrow_move_constructible<Stack>::value);
+    EXPECT_FALSE(std::is_nothrow_move_assignable<Stack>::value);
+}
+
+TEST(TDynamicStackTest, GrowthPolicy) {
+    TDynamicStack<double, 0, TGeometricGrowth<3, 2>> stack(2);
+    std::vector<size_t> capacities;
+    for (int i = 0; i < 20; i++) {
+        if (stack.IsFull()) {
+            stack.Push(i);
+            capacities.push_back(stack.capacity());
+        }
+        else {
+            stack.Push(i);
+        }
+    }
+
+    EXPECT_EQ(capacities, std::vector<size_t>({ 3, 4, 6, 9, 13, 19, 28 }));
+    for (int i = 19; i >= 0; i--) {
+        EXPECT_EQ(stack.Pop(), i);
+    }
+}
+
+namespace {
+
+// Forwards to the heap and keeps track of what is outstanding.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t outstanding = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t align) override {
+        allocations++;
+        outstanding += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        outstanding -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+}
+
+TEST(TDynamicStackTest, MemoryResource) {
+    CountingResource resource;
+    {
+        TDynamicStack<std::string, 2> stack(1, &resource);
+        EXPECT_EQ(stack.GetResource(), &resource);
+        EXPECT_EQ(resource.allocations, 0);
+
+        for (int i = 0; i < 100; i++) {
+            stack.Push(std::to_string(i));
+        }
+        EXPECT_GT(resource.allocations, 0);
+
+        TDynamicStack<std::string, 2> copy(stack);
+        EXPECT_EQ(copy.GetResource(), nullptr);
+
+        TDynamicStack<std::string, 2> moved(std::move(stack));
+        EXPECT_EQ(moved.GetResource(), &resource);
+        EXPECT_EQ(moved.Top(), "99");
+
+        // Different resources: the elements move, the storage stays.
+        copy = std::move(moved);
+        EXPECT_EQ(copy.GetResource(), nullptr);
+        EXPECT_EQ(copy.size(), 100);
+        EXPECT_EQ(copy.Pop(), "99");
+    }
+    EXPECT_EQ(resource.outstanding, 0);
+}
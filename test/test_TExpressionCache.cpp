@@ -0,0 +1,101 @@
+#include <../gtest/gtest.h>
+#include "TExpressionCache.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(TExpressionCacheTest, Normalize) {
+    EXPECT_EQ(TExpressionCache::Normalize(" ( a + b ) * 2 "), "(a+b)*2");
+    EXPECT_EQ(TExpressionCache::Normalize("sin ( x )"), "sin(x)");
+    // Spaces that separate tokens must survive.
+    EXPECT_EQ(TExpressionCache::Normalize("2 3"), "2 3");
+    EXPECT_EQ(TExpressionCache::Normalize("a \t b"), "a b");
+    EXPECT_NE(TExpressionCache::Normalize("2 3"), TExpressionCache::Normalize("23"));
+    // A blank inside an exponent ends the number, so the keys must differ.
+    EXPECT_NE(TExpressionCache::Normalize("2e -3"), TExpressionCache::Normalize("2e-3"));
+    EXPECT_NE(TExpressionCache::Normalize("2e- 3"), TExpressionCache::Normalize("2e-3"));
+    EXPECT_NE(TExpressionCache::Normalize("2e- 3"), TExpressionCache::Normalize("2e -3"));
+    EXPECT_NE(TExpressionCache::Normalize("1.E +2"), TExpressionCache::Normalize("1.E+2"));
+    EXPECT_EQ(TExpressionCache::Normalize("2e-3 + 1"), "2e-3+1");
+    EXPECT_EQ(TExpressionCache::Normalize("2e - 3"), TExpressionCache::Normalize("2e -3"));
+}
+
+TEST(TExpressionCacheTest, HitsShareOneCompiledExpression) {
+    TExpressionCache cache;
+    auto first = cache.Get("a + b*2");
+    auto second = cache.Get("a+b*2");
+    auto third = cache.Get("a+b*3");
+
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first, third);
+    EXPECT_EQ(second->GetInfix(), "a + b*2");
+
+    TExpressionCache::Stats stats = cache.GetStats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.entries, 2);
+    EXPECT_GT(stats.bytes, 0);
+
+    std::vector<double> values = { 1, 2 };
+    EXPECT_EQ(second->Calculate(values), 5);
+}
+
+TEST(TExpressionCacheTest, ParseErrorsAreNotCached) {
+    TExpressionCache cache;
+    EXPECT_THROW(cache.Get("2$3"), std::invalid_argument);
+    EXPECT_THROW(cache.Get("2$3"), std::invalid_argument);
+    EXPECT_EQ(cache.GetStats().entries, 0);
+}
+
+TEST(TExpressionCacheTest, EvictsLeastRecentlyUsedWithinBudget) {
+    size_t entryBytes;
+    {
+        TExpressionCache probe;
+        probe.Get("x+1");
+        entryBytes = probe.GetStats().bytes;
+    }
+
+    // Room for about three entries in a single shard.
+    TExpressionCache cache(entryBytes * 3 + entryBytes / 2, 1);
+    auto keep = cache.Get("x+1");
+    cache.Get("x+2");
+    cache.Get("x+3");
+    cache.Get("x+1");   // refresh
+    cache.Get("x+4");   // evicts x+2
+
+    TExpressionCache::Stats stats = cache.GetStats();
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.entries, 3);
+    EXPECT_LE(stats.bytes, entryBytes * 3 + entryBytes / 2);
+
+    EXPECT_EQ(cache.Get("x+1"), keep);
+    size_t missesBefore = cache.GetStats().misses;
+    cache.Get("x+2");
+    EXPECT_EQ(cache.GetStats().misses, missesBefore + 1);
+
+    cache.Clear();
+    EXPECT_EQ(cache.GetStats().entries, 0);
+    EXPECT_EQ(cache.GetStats().bytes, 0);
+}
+
+TEST(TExpressionCacheTest, ConcurrentLookups) {
+    TExpressionCache cache(1 << 20, 4);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([&cache, t] {
+            for (int i = 0; i < 2000; i++) {
+                int k = (i * 7 + t) % 50;
+                auto expr = cache.Get("x*" + std::to_string(k) + "+1");
+                double x = 2;
+                EXPECT_EQ(expr->Calculate(&x), 2.0 * k + 1);
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    TExpressionCache::Stats stats = cache.GetStats();
+    EXPECT_EQ(stats.hits + stats.misses, 8000);
+    EXPECT_EQ(stats.entries, 50);
+}
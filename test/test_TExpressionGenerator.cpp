@@ -0,0 +1,134 @@
+#include <../gtest/gtest.h>
+#include "TArithmeticExpression.h"
+#include "TExpressionGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+size_t MaxDepth(const std::string& expression) {
+    size_t depth = 0, deepest = 0;
+    for (char c : expression) {
+        if (c == '(') {
+            deepest = std::max(deepest, ++depth);
+        }
+        else if (c == ')') {
+            depth--;
+        }
+    }
+    return deepest;
+}
+
+}
+
+TEST(TExpressionGeneratorTest, RandomStreamIsFixedAcrossPlatforms) {
+    // xoshiro256** seeded with splitmix64(42).
+    TRandom random(42);
+    EXPECT_EQ(random.Next(), 0x15780b2e0c2ec716ull);
+    EXPECT_EQ(random.Next(), 0x6104d9866d113a7eull);
+    EXPECT_EQ(random.Next(), 0xae17533239e499a1ull);
+
+    for (int i = 0; i < 1000; i++) {
+        double u = random.Uniform();
+        EXPECT_GE(u, 0.0);
+        EXPECT_LT(u, 1.0);
+        EXPECT_LT(random.Below(7), 7u);
+    }
+    EXPECT_EQ(random.Below(1), 0u);
+}
+
+TEST(TExpressionGeneratorTest, SameSeedSameExpressions) {
+    TExpressionGenerator::Options options;
+    options.seed = 7;
+    TExpressionGenerator first(options), second(options);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(first.Next(), second.Next());
+    }
+    options.seed = 8;
+    EXPECT_NE(TExpressionGenerator(options).Next(), first.Next());
+}
+
+TEST(TExpressionGeneratorTest, RespectsShapeOptions) {
+    TExpressionGenerator::Options options;
+    options.tokens = 200;
+    options.maxDepth = 3;
+    options.variables = 5;
+    options.trigFrequency = 0.2;
+    TExpressionGenerator generator(options);
+
+    for (int i = 0; i < 50; i++) {
+        std::string text = generator.Next();
+        size_t tokens = TExpressionGenerator::CountTokens(text);
+        EXPECT_LE(tokens, 200u) << text;
+        EXPECT_GE(tokens, 199u) << text;
+        EXPECT_LE(MaxDepth(text), 3u) << text;
+
+        TArithmeticExpression expr(text);
+        for (const std::string& name : expr.GetOperands()) {
+            ASSERT_EQ(name.size(), 1u);
+            EXPECT_LT(name[0], 'a' + 5);
+        }
+        std::vector<double> values(expr.GetOperands().size(), 0.75);
+        EXPECT_NO_THROW(expr.Calculate(values)) << text;
+    }
+}
+
+TEST(TExpressionGeneratorTest, MixOptionsCanSwitchThingsOff) {
+    TExpressionGenerator::Options options;
+    options.tokens = 500;
+    options.trigFrequency = 0;
+    options.groupFrequency = 0;
+    options.literalDensity = 0;
+    options.operatorWeights[0] = 1;
+    options.operatorWeights[1] = 0;
+    options.operatorWeights[2] = 0;
+    options.operatorWeights[3] = 0;
+    std::string text = TExpressionGenerator(options).Next();
+
+    EXPECT_EQ(text.find_first_of("0123456789()-*/"), std::string::npos) << text;
+    EXPECT_EQ(text.find("sin"), std::string::npos);
+    EXPECT_EQ(TExpressionGenerator::CountTokens(text), 499u);
+
+    options.variables = 0;
+    text = TExpressionGenerator(options).Next();
+    TArithmeticExpression constants(text);
+    EXPECT_TRUE(constants.GetOperands().empty()) << text;
+    EXPECT_GT(constants.Calculate(), 0.0);
+
+    options.variables = 27;
+    EXPECT_THROW(TExpressionGenerator generator(options), std::invalid_argument);
+}
+
+TEST(TExpressionGeneratorTest, CountTokensMatchesTheLexer) {
+    EXPECT_EQ(TExpressionGenerator::CountTokens("sin(a) + 1.5e-3*(b/2)"), 12u);
+    EXPECT_EQ(TExpressionGenerator::CountTokens("2e"), 2u);
+}
+
+TEST(TExpressionGeneratorTest, MillionTokenExpressionsParse) {
+    TExpressionGenerator::Options options;
+    options.tokens = 1000000;
+    options.maxDepth = 64;
+    std::string text = TExpressionGenerator(options).Next();
+    EXPECT_GE(TExpressionGenerator::CountTokens(text), 999999u);
+    EXPECT_LE(MaxDepth(text), 64u);
+
+    TArithmeticExpression expr(text);
+    std::vector<double> values(expr.GetOperands().size(), 1.25);
+    EXPECT_NO_THROW(expr.Calculate(values));
+}
+
+TEST(TExpressionGeneratorTest, ColumnsArePrefixStable) {
+    auto small = TExpressionGenerator::GenerateColumns(3, 10, 5);
+    auto large = TExpressionGenerator::GenerateColumns(3, 1000, 5, 0.5, 2.0);
+    ASSERT_EQ(small.size(), 3u);
+    for (size_t v = 0; v < 3; v++) {
+        EXPECT_TRUE(std::equal(small[v].begin(), small[v].end(), large[v].begin()));
+        for (double x : large[v]) {
+            EXPECT_GE(x, 0.5);
+            EXPECT_LT(x, 2.0);
+        }
+    }
+    EXPECT_NE(small[0], small[1]);
+}
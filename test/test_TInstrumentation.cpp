@@ -0,0 +1,123 @@
+#include <../gtest/gtest.h>
+#include "TArithmeticExpression.h"
+#include "TDynamicStack.h"
+#include "TInstrumentation.h"
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(TInstrumentationTest, ReportsAreWellFormed) {
+    TInstrumentation::Snapshot snapshot = {};
+    snapshot.calls[TInstrumentation::PARSE] = 3;
+    snapshot.nanoseconds[TInstrumentation::PARSE] = 4500;
+    snapshot.counters[TInstrumentation::TOKENS] = 17;
+
+    std::ostringstream text;
+    TInstrumentation::WriteText(text, snapshot);
+    EXPECT_NE(text.str().find("parse"), std::string::npos);
+    EXPECT_NE(text.str().find("1500.0"), std::string::npos);
+
+    std::ostringstream json;
+    TInstrumentation::WriteJson(json, snapshot);
+    EXPECT_NE(json.str().find("\"parse\": {\"calls\": 3, \"ns\": 4500}"), std::string::npos);
+    EXPECT_NE(json.str().find("\"tokens\": 17"), std::string::npos);
+}
+
+#if CALC_INSTRUMENTATION
+
+TEST(TInstrumentationTest, CountsPhasesOfAnExpression) {
+    TInstrumentation::Reset();
+    TArithmeticExpression expr("(a+b)*2");
+    double values[] = { 1, 2 };
+    EXPECT_EQ(expr.Calculate(values), 6);
+
+    TInstrumentation::Snapshot snapshot = TInstrumentation::Take();
+    EXPECT_EQ(snapshot.counters[TInstrumentation::EXPRESSIONS], 1u);
+    EXPECT_EQ(snapshot.counters[TInstrumentation::TOKENS], 7u);
+    EXPECT_EQ(snapshot.calls[TInstrumentation::PARSE], 1u);
+    EXPECT_EQ(snapshot.calls[TInstrumentation::TO_POSTFIX], 1u);
+    EXPECT_EQ(snapshot.calls[TInstrumentation::COMPILE], 1u);
+    EXPECT_GE(snapshot.calls[TInstrumentation::EVALUATE], 1u);
+}
+
+TEST(TInstrumentationTest, TracksStackGrowth) {
+    TInstrumentation::Reset();
+    TDynamicStack<int, 4> stack;
+    for (int i = 0; i < 100; i++) {
+        stack.Push(i);
+    }
+
+    TInstrumentation::Snapshot snapshot = TInstrumentation::Take();
+    EXPECT_GT(snapshot.counters[TInstrumentation::STACK_GROWTHS], 0u);
+    EXPECT_EQ(snapshot.counters[TInstrumentation::STACK_HIGH_WATER], 100u);
+}
+
+TEST(TInstrumentationTest, KeepsCountsOfExitedThreads) {
+    TInstrumentation::Reset();
+    std::thread worker([] {
+        TArithmeticExpression expr("a+1");
+    });
+    worker.join();
+    TArithmeticExpression expr("a-1");
+
+    EXPECT_EQ(TInstrumentation::Take().counters[TInstrumentation::EXPRESSIONS], 2u);
+    TInstrumentation::Reset();
+    EXPECT_EQ(TInstrumentation::Take().counters[TInstrumentation::EXPRESSIONS], 0u);
+}
+
+TEST(TInstrumentationTest, WritesTraceEvents) {
+    TInstrumentation::Reset();
+    TInstrumentation::StartTrace();
+    TArithmeticExpression expr("a*b");
+    // Long after process start, one nanosecond apart.
+    auto late = std::chrono::steady_clock::now() + std::chrono::seconds(2000);
+    TInstrumentation::AddPhase(TInstrumentation::EVALUATE, late, late + std::chrono::nanoseconds(123));
+    TInstrumentation::AddPhase(TInstrumentation::EVALUATE, late + std::chrono::nanoseconds(1),
+        late + std::chrono::nanoseconds(124));
+    TInstrumentation::StopTrace();
+    TArithmeticExpression untraced("a/b");
+
+    std::ostringstream trace;
+    TInstrumentation::WriteTrace(trace);
+    std::string json = trace.str();
+    EXPECT_EQ(json.find("{\"displayTimeUnit\": \"ns\", \"traceEvents\": ["), 0u);
+    EXPECT_NE(json.find("\"name\": \"parse\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\": \"X\""), std::string::npos);
+
+    size_t events = 0;
+    for (size_t at = json.find("\"name\""); at != std::string::npos; at = json.find("\"name\"", at + 1)) {
+        events++;
+    }
+    EXPECT_EQ(events, 5u);
+
+    std::vector<double> lateStamps;
+    for (size_t at = json.find("\"ts\": "); at != std::string::npos; at = json.find("\"ts\": ", at + 1)) {
+        double ts = std::strtod(json.c_str() + at + 6, nullptr);
+        if (ts > 1e6) {
+            lateStamps.push_back(ts);
+        }
+    }
+    ASSERT_EQ(lateStamps.size(), 2u);
+    EXPECT_NEAR(lateStamps[1] - lateStamps[0], 0.001, 1e-4);
+    EXPECT_NE(json.find("\"dur\": 0.123,"), std::string::npos);
+    EXPECT_EQ(json.find("e+"), std::string::npos);
+}
+
+#else
+
+TEST(TInstrumentationTest, DisabledBuildRecordsNothing) {
+    TInstrumentation::Reset();
+    TArithmeticExpression expr("a+b");
+    double values[] = { 1, 2 };
+    EXPECT_EQ(expr.Calculate(values), 3);
+
+    EXPECT_FALSE(TInstrumentation::Enabled());
+    TInstrumentation::Snapshot snapshot = TInstrumentation::Take();
+    EXPECT_EQ(snapshot.counters[TInstrumentation::EXPRESSIONS], 0u);
+    EXPECT_EQ(snapshot.calls[TInstrumentation::PARSE], 0u);
+}
+
+#endif
@@ -0,0 +1,97 @@
+#include <../gtest/gtest.h>
+#include "TJitExpression.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+std::vector<double> SlotValues(const TArithmeticExpression& expr, double seed) {
+    std::vector<double> values(expr.GetOperands().size());
+    for (size_t i = 0; i < values.size(); i++) {
+        values[i] = seed + 0.75 * i + 0.125;
+    }
+    return values;
+}
+
+std::string DeepSum(int terms) {
+    std::string s = "x";
+    for (int i = 0; i < terms; i++) {
+        s = "(" + std::to_string(i) + "+" + s + ")";
+    }
+    for (int i = 0; i < terms; i++) {
+        s = std::to_string(i + 1) + "*(" + s + ")";
+    }
+    return s;
+}
+
+}
+
+TEST(TJitExpressionTest, CompilesOnSupportedTargets) {
+    TJitExpression jit(TArithmeticExpression("a+b*2"));
+    EXPECT_EQ(jit.IsCompiled(), TJitExpression::IsSupported());
+}
+
+TEST(TJitExpressionTest, MatchesInterpreter) {
+    const char* formulas[] = {
+        "2+3", "pi", "x", "a-b-c", "a/b/c", "(a+b)*(c-d)/(e+1)",
+        "sin(x)", "cos(y)*2", "a+sin(b)*cos(c)-d", "sin(cos(sin(x)))",
+        "(a+1)*(b+2)*(c+3)*(d+4)*(e+5)*(f+6)*(g+7)*(h+8)",
+        "a*(b+c*(d-e*(f+g/(h-i*(j+k)))))", "1-sin(a)+2*cos(b)*sin(c+3*cos(d))",
+        "sin(a+b)*cos(b+a)+(a+b)/(c*d)-d*c"
+    };
+
+    for (const char* formula : formulas) {
+        TArithmeticExpression expr(formula);
+        TJitExpression jit(expr);
+        for (double seed = -3; seed <= 3; seed += 0.5) {
+            std::vector<double> values = SlotValues(expr, seed);
+            EXPECT_EQ(jit.Calculate(values.data()), expr.Calculate(values.data())) << formula << " seed " << seed;
+        }
+    }
+}
+
+TEST(TJitExpressionTest, DeepProgramsFallBackToInterpreter) {
+    TArithmeticExpression shallow(DeepSum(3));
+    TArithmeticExpression deep(DeepSum(20));
+    ASSERT_GT(deep.GetStackDepth(), TJitExpression::kMaxRegisters);
+
+    TJitExpression jitDeep(deep);
+    EXPECT_FALSE(jitDeep.IsCompiled());
+    double x = 1.5;
+    EXPECT_EQ(jitDeep.Calculate(&x), deep.Calculate(&x));
+
+    TJitExpression jitShallow(shallow);
+    EXPECT_EQ(jitShallow.Calculate(&x), shallow.Calculate(&x));
+}
+
+TEST(TJitExpressionTest, Errors) {
+    TJitExpression div(TArithmeticExpression("a/(b-1)"));
+    double values[] = { 1, 1 };
+    EXPECT_THROW(div.Calculate(values), std::runtime_error);
+    values[1] = 3;
+    EXPECT_EQ(div.Calculate(values), 0.5);
+
+    TJitExpression bad(TArithmeticExpression("sin"));
+    EXPECT_FALSE(bad.IsCompiled());
+    EXPECT_THROW(bad.Calculate(values), std::runtime_error);
+}
+
+TEST(TJitExpressionTest, WritesPerfMap) {
+    if (!TJitExpression::IsSupported()) {
+        return;
+    }
+    std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+    std::remove(path.c_str());
+
+    TJitExpression jit(TArithmeticExpression("x * 2 + 1"), true);
+    ASSERT_TRUE(jit.IsCompiled());
+
+    std::ifstream in(path);
+    std::string line;
+    ASSERT_TRUE(static_cast<bool>(std::getline(in, line)));
+    EXPECT_NE(line.find("[x*2+1]"), std::string::npos);
+    std::remove(path.c_str());
+}
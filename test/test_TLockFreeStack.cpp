@@ -0,0 +1,122 @@
+#include <../gtest/gtest.h>
+#include "TLockFreeStack.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(TLockFreeStackTest, PushAndPop) {
+    TLockFreeStack<int> stack;
+    EXPECT_TRUE(stack.IsEmpty());
+
+    stack.Push(10);
+    stack.Push(20);
+    stack.Emplace(30);
+    EXPECT_FALSE(stack.IsEmpty());
+
+    EXPECT_EQ(stack.Pop(), 30);
+    EXPECT_EQ(stack.Pop(), 20);
+    EXPECT_EQ(stack.Pop(), 10);
+    EXPECT_TRUE(stack.IsEmpty());
+}
+
+TEST(TLockFreeStackTest, PopFromEmptyStack) {
+    TLockFreeStack<int> stack;
+    EXPECT_THROW(stack.Pop(), std::underflow_error);
+
+    int value = 7;
+    EXPECT_FALSE(stack.TryPop(value));
+    EXPECT_EQ(value, 7);
+
+    stack.Push(1);
+    EXPECT_TRUE(stack.TryPop(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_FALSE(stack.TryPop(value));
+}
+
+TEST(TLockFreeStackTest, MoveOnlyAndOwningElements) {
+    TLockFreeStack<std::unique_ptr<std::string>> stack;
+    stack.Push(std::make_unique<std::string>("first"));
+    stack.Push(std::make_unique<std::string>("second"));
+    stack.Push(std::make_unique<std::string>("left in the stack"));
+
+    std::unique_ptr<std::string> out;
+    EXPECT_TRUE(stack.TryPop(out));
+    EXPECT_EQ(*out, "left in the stack");
+    EXPECT_EQ(*stack.Pop(), "second");
+    stack.Push(std::make_unique<std::string>("reuses a node"));
+    // The destructor frees what is still in the stack.
+}
+
+TEST(TLockFreeStackTest, ProducersAndConsumersSeeEveryValueOnce) {
+    const int producers = 4;
+    const int consumers = 4;
+    const int perProducer = 20000;
+    TLockFreeStack<int> stack;
+    std::vector<std::atomic<int>> seen(producers * perProducer);
+    std::atomic<int> consumed(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < perProducer; i++) {
+                stack.Push(p * perProducer + i);
+            }
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&] {
+            int value;
+            while (consumed.load() < producers * perProducer) {
+                if (stack.TryPop(value)) {
+                    seen[value]++;
+                    consumed++;
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    EXPECT_TRUE(stack.IsEmpty());
+    for (size_t i = 0; i < seen.size(); i++) {
+        ASSERT_EQ(seen[i].load(), 1) << i;
+    }
+}
+
+TEST(TLockFreeStackTest, MixedPushPopKeepsBalance) {
+    // Every thread pushes and pops repeatedly, so nodes are recycled through
+    // the free list all the time; a lost or duplicated node changes the sum.
+    const int threadCount = 8;
+    const int rounds = 20000;
+    TLockFreeStack<long long> stack;
+    std::atomic<long long> popped(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t] {
+            long long value;
+            for (int i = 0; i < rounds; i++) {
+                stack.Push(t * rounds + i);
+                if (i % 3 != 0 && stack.TryPop(value)) {
+                    popped += value;
+                }
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    long long value;
+    while (stack.TryPop(value)) {
+        popped += value;
+    }
+    long long n = static_cast<long long>(threadCount) * rounds;
+    EXPECT_EQ(popped.load(), n * (n - 1) / 2);
+}
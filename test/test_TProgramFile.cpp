@@ -0,0 +1,144 @@
+#include <../gtest/gtest.h>
+#include "TArithmeticExpression.h"
+#include "TProgramFile.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string TempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("calc_test_" + name)).string();
+}
+
+const char* const kFormulas[] = { "2+3*4", "(a+b)*sin(c)", "x/y-cos(x*y)+(x*y)", "pi" };
+
+void WriteFormulas(const std::string& path, bool withSource) {
+    std::vector<std::shared_ptr<const TCompiledProgram>> programs;
+    std::vector<std::string> sources;
+    for (const char* formula : kFormulas) {
+        programs.push_back(TArithmeticExpression(formula).GetCompiledProgram());
+        sources.push_back(formula);
+    }
+    TProgramFile::Write(path, programs, withSource ? sources : std::vector<std::string>());
+}
+
+void Patch(const std::string& path, size_t offset, const void* bytes, size_t size) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(static_cast<const char*>(bytes), size);
+}
+
+}
+
+TEST(TProgramFileTest, LoadedProgramsMatchCompiledOnes) {
+    std::string path = TempPath("programs.bin");
+    WriteFormulas(path, true);
+
+    std::shared_ptr<const TCompiledProgram> kept;
+    {
+        TProgramFile file(path);
+        ASSERT_EQ(file.Size(), 4);
+        double values[] = { 0.5, 1.5, 2.5 };
+        for (size_t i = 0; i < file.Size(); i++) {
+            TArithmeticExpression expr(kFormulas[i]);
+            auto program = file.GetProgram(i);
+            EXPECT_EQ(file.GetSource(i), kFormulas[i]);
+            EXPECT_TRUE(program->GetCode().empty());
+            ASSERT_EQ(program->GetInstructionCount(), expr.GetProgram().size());
+            EXPECT_EQ(std::vector<std::string>(program->GetOperands().begin(), program->GetOperands().end()),
+                expr.GetOperands());
+            EXPECT_EQ(program->GetStackDepth(), expr.GetStackDepth());
+
+            TEvaluationContext ctx;
+            EXPECT_EQ(program->Evaluate(values, ctx), expr.Calculate(values)) << kFormulas[i];
+        }
+        kept = file.GetProgram(1);
+        EXPECT_EQ(kept->GetOperandIndex("c"), 2);
+    }
+
+    // The program keeps the mapping alive after the file object is gone.
+    double values[] = { 1, 2, 0 };
+    TEvaluationContext ctx;
+    EXPECT_EQ(kept->Evaluate(values, ctx), 0.0);
+    kept.reset();
+    std::remove(path.c_str());
+}
+
+TEST(TProgramFileTest, SourceIsOptional) {
+    std::string path = TempPath("nosource.bin");
+    WriteFormulas(path, false);
+    TProgramFile file(path);
+    EXPECT_EQ(file.GetSource(0), "");
+    EXPECT_THROW(file.GetProgram(4), std::out_of_range);
+    std::remove(path.c_str());
+}
+
+TEST(TProgramFileTest, MalformedProgramsAreNotWritten) {
+    std::pmr::vector<Instruction> code = { Instruction(Instruction::ADD) };
+    auto program = std::make_shared<const TCompiledProgram>(code, std::pmr::vector<std::pmr::string>());
+    EXPECT_THROW(TProgramFile::Write(TempPath("bad.bin"), { program }), std::invalid_argument);
+}
+
+TEST(TProgramFileTest, RejectsDamagedFiles) {
+    std::string path = TempPath("damaged.bin");
+    const size_t kHeader = 32;
+    const size_t kEntry = sizeof(TProgramFile::Entry);
+
+    WriteFormulas(path, true);
+    Patch(path, 0, "CALCPROX", 8);
+    EXPECT_THROW(TProgramFile file(path), std::runtime_error);
+
+    WriteFormulas(path, true);
+    uint32_t version = 7;
+    Patch(path, 8, &version, sizeof(version));
+    EXPECT_THROW(TProgramFile file(path), std::runtime_error);
+
+    WriteFormulas(path, true);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    EXPECT_THROW(TProgramFile file(path), std::runtime_error);
+
+    // A code offset pointing past the end of the file.
+    WriteFormulas(path, true);
+    uint64_t offset = uint64_t(1) << 40;
+    Patch(path, kHeader, &offset, sizeof(offset));
+    EXPECT_THROW(TProgramFile file(path), std::runtime_error);
+
+    // An opcode outside the instruction set.
+    WriteFormulas(path, true);
+    TProgramFile::Entry entry;
+    {
+        TProgramFile file(path);
+        std::ifstream in(path, std::ios::binary);
+        in.seekg(kHeader + kEntry);
+        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+    }
+    uint32_t op = 99;
+    Patch(path, entry.codeOffset, &op, sizeof(op));
+    {
+        TProgramFile file(path);
+        EXPECT_NO_THROW(file.GetProgram(0));
+        EXPECT_THROW(file.GetProgram(1), std::runtime_error);
+    }
+
+    // A variable slot beyond the variable table.
+    WriteFormulas(path, true);
+    uint64_t slot = 1000;
+    Patch(path, entry.codeOffset + offsetof(Instruction, slot), &slot, sizeof(slot));
+    EXPECT_THROW(TProgramFile(path).GetProgram(1), std::runtime_error);
+
+    // Swapping the first two names leaves the table unsorted.
+    WriteFormulas(path, true);
+    Patch(path, entry.namesOffset + 4, "b", 1);
+    Patch(path, entry.namesOffset + 9, "a", 1);
+    EXPECT_THROW(TProgramFile(path).GetProgram(1), std::runtime_error);
+
+    // A name length running past the table.
+    WriteFormulas(path, true);
+    uint32_t length = 1000;
+    Patch(path, entry.namesOffset, &length, sizeof(length));
+    EXPECT_THROW(TProgramFile(path).GetProgram(1), std::runtime_error);
+    std::remove(path.c_str());
+}
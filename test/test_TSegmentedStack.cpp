@@ -0,0 +1,135 @@
+#include <../gtest/gtest.h>
+#include "TSegmentedStack.h"
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+TEST(TSegmentedStackTest, PushAndPopAcrossChunks) {
+    TSegmentedStack<int, 4> stack;
+    EXPECT_TRUE(stack.IsEmpty());
+    EXPECT_EQ(stack.capacity(), 0);
+
+    for (int i = 0; i < 100; i++) {
+        stack.Push(i);
+        EXPECT_EQ(stack.Top(), i);
+    }
+    EXPECT_EQ(stack.size(), 100);
+
+    for (int i = 99; i >= 0; i--) {
+        EXPECT_EQ(stack.Pop(), i);
+    }
+    EXPECT_TRUE(stack.IsEmpty());
+}
+
+TEST(TSegmentedStackTest, PopFromEmptyStack) {
+    TSegmentedStack<int> stack;
+    EXPECT_THROW(stack.Pop(), std::underflow_error);
+    EXPECT_THROW(stack.Top(), std::underflow_error);
+
+    stack.Push(1);
+    stack.Pop();
+    EXPECT_THROW(stack.Pop(), std::underflow_error);
+}
+
+TEST(TSegmentedStackTest, ReferencesStayValid) {
+    TSegmentedStack<std::string, 8> stack;
+    std::vector<std::string*> refs;
+    for (int i = 0; i < 1000; i++) {
+        refs.push_back(&stack.Emplace(std::to_string(i)));
+    }
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(*refs[i], std::to_string(i));
+    }
+}
+
+TEST(TSegmentedStackTest, SpareChunkAtBoundary) {
+    TSegmentedStack<int, 4> stack;
+    for (int i = 0; i < 5; i++) {
+        stack.Push(i);
+    }
+    EXPECT_EQ(stack.capacity(), 8);
+
+    // Going back and forth across the boundary reuses the spare.
+    for (int i = 0; i < 10; i++) {
+        stack.Pop();
+        EXPECT_EQ(stack.capacity(), 8);
+        stack.Push(i);
+        EXPECT_EQ(stack.capacity(), 8);
+    }
+
+    // Only one spare chunk is kept while draining.
+    for (int i = 0; i < 12; i++) {
+        stack.Push(i);
+    }
+    EXPECT_EQ(stack.capacity(), 20);
+    while (!stack.IsEmpty()) {
+        stack.Pop();
+        size_t used = std::max<size_t>(stack.size(), 1);
+        EXPECT_LE(stack.capacity(), (used + 3) / 4 * 4 + 4);
+    }
+    EXPECT_EQ(stack.capacity(), 8);
+}
+
+TEST(TSegmentedStackTest, MoveOnlyElements) {
+    TSegmentedStack<std::unique_ptr<int>, 2> stack;
+    for (int i = 0; i < 5; i++) {
+        stack.Push(std::make_unique<int>(i));
+    }
+    EXPECT_EQ(*stack.Pop(), 4);
+    EXPECT_EQ(*stack.PopUnchecked(), 3);
+    EXPECT_EQ(*stack.TopUnchecked(), 2);
+}
+
+TEST(TSegmentedStackTest, CopyAndMove) {
+    TSegmentedStack<std::string, 3> stack;
+    for (int i = 0; i < 10; i++) {
+        stack.Push(std::to_string(i));
+    }
+
+    TSegmentedStack<std::string, 3> copy(stack);
+    EXPECT_EQ(copy.size(), 10);
+    copy.Pop();
+    EXPECT_EQ(stack.Top(), "9");
+    EXPECT_EQ(copy.Top(), "8");
+
+    TSegmentedStack<std::string, 3> assigned;
+    assigned.Push("x");
+    assigned = copy;
+    EXPECT_EQ(assigned.size(), 9);
+
+    TSegmentedStack<std::string, 3> moved(std::move(stack));
+    EXPECT_TRUE(stack.IsEmpty());
+    EXPECT_EQ(moved.size(), 10);
+    for (int i = 9; i >= 0; i--) {
+        EXPECT_EQ(moved.Pop(), std::to_string(i));
+    }
+
+    stack = std::move(assigned);
+    EXPECT_EQ(stack.Pop(), "8");
+    stack.Push("reused");
+    EXPECT_EQ(stack.Top(), "reused");
+}
+
+TEST(TSegmentedStackTest, MemoryResource) {
+    std::vector<char> buffer(1 << 16);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+    TSegmentedStack<double, 16> stack(&arena);
+    for (int i = 0; i < 1000; i++) {
+        stack.Push(i);
+    }
+    EXPECT_EQ(stack.GetResource(), &arena);
+
+    TSegmentedStack<double, 16> heap(stack);
+    EXPECT_EQ(heap.GetResource(), nullptr);
+    EXPECT_EQ(heap.size(), 1000);
+
+    heap = std::move(stack);
+    EXPECT_EQ(heap.GetResource(), nullptr);
+    EXPECT_TRUE(stack.IsEmpty());
+    for (int i = 999; i >= 0; i--) {
+        EXPECT_EQ(heap.Pop(), i);
+    }
+}
@@ -0,0 +1,91 @@
+#include <../gtest/gtest.h>
+#include "TThreadPool.h"
+#include "TArithmeticExpression.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST(TThreadPoolTest, DefaultSizeIsPositive) {
+    TThreadPool pool;
+    EXPECT_GE(pool.Size(), 1);
+
+    TThreadPool three(3);
+    EXPECT_EQ(three.Size(), 3);
+}
+
+TEST(TThreadPoolTest, ParallelForCoversEveryIndexOnce) {
+    TThreadPool pool(4);
+    std::vector<std::atomic<int>> hits(10007);
+    for (auto& h : hits) {
+        h = 0;
+    }
+
+    pool.ParallelFor(0, hits.size(), 13, [&](size_t first, size_t last) {
+        EXPECT_LE(last - first, 13);
+        for (size_t i = first; i < last; i++) {
+            hits[i]++;
+        }
+    });
+
+    for (size_t i = 0; i < hits.size(); i++) {
+        EXPECT_EQ(hits[i], 1) << "index " << i;
+    }
+}
+
+TEST(TThreadPoolTest, EmptyRangeAndReuse) {
+    TThreadPool pool(2);
+    int calls = 0;
+    pool.ParallelFor(5, 5, 1, [&](size_t, size_t) { calls++; });
+    EXPECT_EQ(calls, 0);
+
+    for (int round = 0; round < 50; round++) {
+        std::atomic<size_t> sum(0);
+        pool.ParallelFor(0, 1000, 7, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) sum += i;
+        });
+        EXPECT_EQ(sum, 999 * 1000 / 2);
+    }
+}
+
+TEST(TThreadPoolTest, ExceptionIsRethrownToCaller) {
+    TThreadPool pool(3);
+    EXPECT_THROW(pool.ParallelFor(0, 100, 10, [](size_t first, size_t) {
+        if (first == 50) {
+            throw std::runtime_error("boom");
+        }
+    }), std::runtime_error);
+
+    // The pool stays usable afterwards.
+    std::atomic<size_t> covered(0);
+    pool.ParallelFor(0, 100, 10, [&](size_t first, size_t last) { covered += last - first; });
+    EXPECT_EQ(covered, 100);
+}
+
+TEST(TThreadPoolTest, PinnedWorkersStillRun) {
+    TThreadPool pool(2, std::vector<int>{ 0 });
+    std::atomic<size_t> n(0);
+    pool.ParallelFor(0, 64, 4, [&](size_t first, size_t last) { n += last - first; });
+    EXPECT_EQ(n, 64);
+}
+
+TEST(TThreadPoolTest, ParallelBatchMatchesSequentialBatch) {
+    TArithmeticExpression expr("a*b-c/(a+1)+cos(b)");
+    const size_t rows = 100003;
+    std::vector<double> a(rows), b(rows), c(rows);
+    for (size_t r = 0; r < rows; r++) {
+        a[r] = r * 0.5;
+        b[r] = 1.0 / (r + 1);
+        c[r] = r % 17;
+    }
+    const double* columns[] = { a.data(), b.data(), c.data() };
+
+    std::vector<double> sequential(rows), parallel(rows);
+    expr.CalculateBatch(columns, sequential.data(), rows);
+
+    TThreadPool pool(4);
+    expr.CalculateBatch(columns, parallel.data(), rows, pool);
+    EXPECT_EQ(sequential, parallel);
+
+    a[rows - 1] = -1;
+    EXPECT_THROW(expr.CalculateBatch(columns, parallel.data(), rows, pool), std::runtime_error);
+}
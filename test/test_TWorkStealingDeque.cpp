@@ -0,0 +1,115 @@
+#include <../gtest/gtest.h>
+#include "TWorkStealingDeque.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(TWorkStealingDequeTest, OwnerEndIsLastInFirstOut) {
+    TWorkStealingDeque<int> deque;
+    EXPECT_TRUE(deque.IsEmpty());
+
+    deque.Push(1);
+    deque.Push(2);
+    deque.Push(3);
+    EXPECT_EQ(deque.size(), 3);
+
+    EXPECT_EQ(deque.Pop(), 3);
+    EXPECT_EQ(deque.Pop(), 2);
+    EXPECT_EQ(deque.Pop(), 1);
+    EXPECT_TRUE(deque.IsEmpty());
+    EXPECT_THROW(deque.Pop(), std::underflow_error);
+
+    int value = 0;
+    EXPECT_FALSE(deque.TryPop(value));
+}
+
+TEST(TWorkStealingDequeTest, ThievesTakeTheOldest) {
+    TWorkStealingDeque<int> deque;
+    for (int i = 0; i < 5; i++) {
+        deque.Push(i);
+    }
+
+    int value = -1;
+    EXPECT_TRUE(deque.TrySteal(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(deque.TrySteal(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_EQ(deque.Pop(), 4);
+    EXPECT_EQ(deque.size(), 2);
+
+    EXPECT_TRUE(deque.TryPop(value));
+    EXPECT_TRUE(deque.TrySteal(value));
+    EXPECT_EQ(value, 2);
+    EXPECT_FALSE(deque.TrySteal(value));
+}
+
+TEST(TWorkStealingDequeTest, GrowsAndKeepsOrder) {
+    TWorkStealingDeque<int> deque(4);
+    int value;
+    // Steal a few first, so that the live range wraps around the buffer.
+    for (int i = 0; i < 3; i++) {
+        deque.Push(-1);
+    }
+    for (int i = 0; i < 3; i++) {
+        EXPECT_TRUE(deque.TrySteal(value));
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        deque.Push(i);
+    }
+    EXPECT_EQ(deque.size(), 1000);
+    EXPECT_TRUE(deque.TrySteal(value));
+    EXPECT_EQ(value, 0);
+    for (int i = 999; i >= 1; i--) {
+        EXPECT_EQ(deque.Pop(), i);
+    }
+    EXPECT_TRUE(deque.IsEmpty());
+}
+
+TEST(TWorkStealingDequeTest, EveryElementIsTakenOnce) {
+    // The owner keeps pushing and popping while thieves steal, which
+    // exercises the race for the last element and growth under stealing.
+    const int items = 200000;
+    const int thieves = 4;
+    TWorkStealingDeque<int> deque(8);
+    std::vector<std::atomic<int>> taken(items);
+    std::atomic<int> count(0);
+    std::atomic<bool> done(false);
+
+    std::vector<std::thread> threads;
+    for (int k = 0; k < thieves; k++) {
+        threads.emplace_back([&] {
+            int value;
+            while (!done.load()) {
+                if (deque.TrySteal(value)) {
+                    taken[value]++;
+                    count++;
+                }
+            }
+        });
+    }
+
+    int value;
+    for (int i = 0; i < items; i++) {
+        deque.Push(i);
+        if (i % 3 == 0 && deque.TryPop(value)) {
+            taken[value]++;
+            count++;
+        }
+    }
+    while (count.load() < items) {
+        if (deque.TryPop(value)) {
+            taken[value]++;
+            count++;
+        }
+    }
+    done = true;
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(count.load(), items);
+    for (int i = 0; i < items; i++) {
+        ASSERT_EQ(taken[i].load(), 1) << i;
+    }
+}